@@ -0,0 +1,58 @@
+#ifndef CASCADEDETECTOR_H
+#define CASCADEDETECTOR_H
+
+#include <vector>
+#include <string>
+#include <opencv2/core/core.hpp>
+#include <opencv2/objdetect/objdetect.hpp>
+
+/*
+ * Multi-threaded cascade detection (Haar or LBP, old or new format files)
+ * with the neighbour score of the legacy cvHaarDetectObjects.
+ *
+ * The scale pyramid is cut into bands of consecutive scales with about the
+ * same number of windows, and the bands run side by side in cv::parallel_for_,
+ * each on its own classifier (detectMultiScale is not reentrant). The raw hits
+ * of all bands are grouped once with cv::groupRectangles, which gives the same
+ * neighbour count per face as the C API did.
+ */
+
+class CCascadeDetector
+{
+public:
+    struct Detection {
+        cv::Rect rect;
+        int neighbors;
+    };
+
+private:
+    class BandInvoker;
+
+    std::vector<cv::CascadeClassifier> classifiers;
+    cv::Size window;
+
+    // smallest and largest window of each band
+    std::vector<cv::Size> bandMin;
+    std::vector<cv::Size> bandMax;
+    std::vector<std::vector<cv::Rect> > bandHits;
+
+    std::vector<cv::Rect> hits;
+    std::vector<int> neighbors;
+
+    void planBands(const cv::Size& image, double scaleFactor, cv::Size minSize, cv::Size maxSize);
+
+public:
+    CCascadeDetector();
+
+    // bands < 1 is one band per CPU
+    bool load(const std::string& file, int bands = 0);
+    bool empty() const;
+    bool isOldFormat() const;
+
+    // gray 8 bit image, minNeighbors as in cvHaarDetectObjects
+    void detect(const cv::Mat& gray, std::vector<Detection>& detections,
+                double scaleFactor, int minNeighbors, int flags,
+                cv::Size minSize, cv::Size maxSize = cv::Size());
+};
+
+#endif // CASCADEDETECTOR_H
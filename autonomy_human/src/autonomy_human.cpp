@@ -16,6 +16,7 @@
 
 #include "autonomy_human/human.h"
 #include "autonomy_human/raw_detections.h"
+#include "cascadedetector.h"
 
 using namespace cv;
 using namespace std;
@@ -71,6 +72,14 @@ private:
 	Size minFaceSize;
 	Size maxFaceSize;
 
+	// Kalman guided search, with a full-frame sweep every fullSweepFrames
+	bool roiSearchEnabled;
+	int fullSweepFrames;
+	float roiSigma;
+	int sweepCounter;
+	Size searchMinFaceSize;
+	Size searchMaxFaceSize;
+
 	// Histograms (Skin)
 	MatND faceHist;
 	int hbins;
@@ -105,10 +114,10 @@ private:
 	bool skinEnabled;
     bool gestureEnabled;
 
-    // C API is needed for score
-    // But let's add smart pointers
-    cv::Ptr<CvHaarClassifierCascade> cascade;
-    cv::Ptr<CvHaarClassifierCascade> cascadeProfile;
+    // Scale bands run in parallel, the neighbour score is the one of the C API
+    CCascadeDetector cascade;
+    CCascadeDetector cascadeProfile;
+    vector<CCascadeDetector::Detection> detections;
 
     void copyKalman(const KalmanFilter& src, KalmanFilter& dest);
 	void resetKalmanFilter();
@@ -122,16 +131,13 @@ private:
 	void draw();
 	void safeRect(Rect &r, Rect &boundry);
     void safeRectToImage(Rect &r, double fx = 1.0, double fy = 1.0);
+    void searchFullFrame();
+    void updateSearchROI(double dt);
 
    // Temp
-    CvAvgComp MLFace;
+    CCascadeDetector::Detection MLFace;
     string frame_id;
 
-    // We need C API to get score
-    // Let's use OpenCV Smart Pointers to old data structures
-    cv::Ptr<CvMemStorage> storage;
-    cv::Ptr<CvMemStorage> storageProfile;
-
     ros::Publisher& facePub;
     ros::Publisher& allDetectionsPub;
     image_transport::Publisher& debugPub;
@@ -144,7 +150,8 @@ public:
                   int _minFaceSizeW, int _minFaceSizeH, int _maxFaceSizeW, int _maxFaceSizeH,
                   int _initialScoreMin, int _initialDetectFrames, int _initialRejectFrames, int _minFlow,
                   bool _profileHackEnabled, bool _skinEnabled, bool _gestureEnabled,
-                  unsigned short int _debugLevel, unsigned int _stablization,
+                  unsigned short int _debugLevel, unsigned int _stablization, int _detectorThreads,
+                  bool _roiSearchEnabled, int _fullSweepFrames, float _roiSigma,
                   ros::Publisher& _facePub, ros::Publisher& _allDetectionsPub,
                   image_transport::Publisher& _debugPub, image_transport::Publisher& _skinPub, image_transport::Publisher& _opticalPub);
 
@@ -186,7 +193,8 @@ CHumanTracker::CHumanTracker(string &cascadeFile, string &cascadeFileProfile,
                              int _minFaceSizeW, int _minFaceSizeH, int _maxFaceSizeW, int _maxFaceSizeH,
                              int _initialScoreMin, int _initialDetectFrames, int _initialRejectFrames, int _minFlow,
                              bool _profileHackEnabled, bool _skinEnabled, bool _gestureEnabled,
-                             unsigned short int _debugLevel, unsigned int _stablization,
+                             unsigned short int _debugLevel, unsigned int _stablization, int _detectorThreads,
+                             bool _roiSearchEnabled, int _fullSweepFrames, float _roiSigma,
                              ros::Publisher& _facePub, ros::Publisher& _allDetectionsPub,
                              image_transport::Publisher& _debugPub, image_transport::Publisher& _skinPub, image_transport::Publisher& _opticalPub)
     : KFTracker(6, 4, 0)
@@ -200,6 +208,12 @@ CHumanTracker::CHumanTracker(string &cascadeFile, string &cascadeFileProfile,
     , maxRejectCov(6.0)
     , minFaceSize(_minFaceSizeW, _minFaceSizeH)
     , maxFaceSize(_maxFaceSizeW, _maxFaceSizeH)
+    , roiSearchEnabled(_roiSearchEnabled)
+    , fullSweepFrames(_fullSweepFrames)
+    , roiSigma(_roiSigma)
+    , sweepCounter(0)
+    , searchMinFaceSize(_minFaceSizeW, _minFaceSizeH)
+    , searchMaxFaceSize(_maxFaceSizeW, _maxFaceSizeH)
     , hbins(15)
     , sbins(16)
     , minFlow(_minFlow)
@@ -207,8 +221,6 @@ CHumanTracker::CHumanTracker(string &cascadeFile, string &cascadeFileProfile,
     , profileHackEnabled(_profileHackEnabled)
     , skinEnabled(_skinEnabled)
     , gestureEnabled(_gestureEnabled)
-    , storage(cvCreateMemStorage(0))
-    , storageProfile(cvCreateMemStorage(0))
     , facePub(_facePub)
     , allDetectionsPub(_allDetectionsPub)
     , debugPub(_debugPub)
@@ -225,15 +237,19 @@ CHumanTracker::CHumanTracker(string &cascadeFile, string &cascadeFileProfile,
 	strStates[2] = "TRACKG";
 	strStates[3] = "REJECT";
 
-	cascade = (CvHaarClassifierCascade*) cvLoad(cascadeFile.c_str(), 0, 0, 0);
-    if (cascade.empty())
+    // Haar or LBP, old or new format
+    if (!cascade.load(cascadeFile, _detectorThreads))
 	{
 		ROS_ERROR("Problem loading cascade file %s", cascadeFile.c_str());
 	}
+    else
+    {
+        ROS_INFO("Cascade is in the %s format", cascade.isOldFormat() ? "old Haar" : "new");
+    }
 
+    // The profile search is small, one band is enough
     if (profileHackEnabled) {
-        cascadeProfile = (CvHaarClassifierCascade*) cvLoad(cascadeFileProfile.c_str(), 0, 0, 0);
-        if (cascade.empty())
+        if (!cascadeProfile.load(cascadeFileProfile, 1))
         {
             ROS_ERROR("Problem loading profile cascade file %s", cascadeFileProfile.c_str());
         }
@@ -357,7 +373,7 @@ void CHumanTracker::copyKalman(const KalmanFilter& src, KalmanFilter& dest)
 void CHumanTracker::reset()
 {
 	trackingState = STATE_LOST;
-	searchROI = Rect(Point(0,0), Point(iWidth,iHeight));
+	searchFullFrame();
 
 	// x,y,xdot,ydot,w,h
 	state = Mat::zeros(6, 1, CV_32F);
@@ -477,6 +493,61 @@ void CHumanTracker::safeRectToImage(Rect& r, double fx, double fy)
 	safeRect(r, safety);
 }
 
+void CHumanTracker::searchFullFrame()
+{
+	searchROI = Rect(0, 0, iWidth, iHeight);
+	searchMinFaceSize = minFaceSize;
+	searchMaxFaceSize = maxFaceSize;
+	sweepCounter = 0;
+}
+
+/*
+ * While tracking, the next frame is only searched around the predicted face:
+ * one face size on each side plus roiSigma standard deviations of the
+ * position, for faces of about the believed size. The whole frame is searched
+ * every fullSweepFrames frames to pick up new people, and in all the other
+ * states, so a missed face (STATE_REJECT) is looked for everywhere.
+ */
+void CHumanTracker::updateSearchROI(double dt)
+{
+	sweepCounter++;
+
+	const Mat& x = KFTracker.statePost;
+	const Mat& P = KFTracker.errorCovPost;
+	const float w = x.at<float>(4);
+	const float h = x.at<float>(5);
+
+	if ((!roiSearchEnabled) || (trackingState != STATE_TRACK) ||
+		(sweepCounter >= fullSweepFrames) || (w <= 0) || (h <= 0))
+	{
+		searchFullFrame();
+		return;
+	}
+
+	// Predicted center of the face in the next frame
+	const float cx = x.at<float>(0) + x.at<float>(2) * dt + 0.5 * w;
+	const float cy = x.at<float>(1) + x.at<float>(3) * dt + 0.5 * h;
+
+	const float hw = 1.5 * w + roiSigma * sqrt(P.at<float>(0,0));
+	const float hh = 1.5 * h + roiSigma * sqrt(P.at<float>(1,1));
+	Rect frameRect(0, 0, iWidth, iHeight);
+	searchROI = Rect(cx - hw, cy - hh, 2 * hw, 2 * hh);
+	safeRect(searchROI, frameRect);
+
+	const float sw = roiSigma * sqrt(P.at<float>(4,4));
+	const float sh = roiSigma * sqrt(P.at<float>(5,5));
+	searchMinFaceSize.width = max<int>(0.8 * w - sw, minFaceSize.width);
+	searchMinFaceSize.height = max<int>(0.8 * h - sh, minFaceSize.height);
+	searchMaxFaceSize.width = max<int>(min<int>(1.25 * w + sw, maxFaceSize.width), searchMinFaceSize.width);
+	searchMaxFaceSize.height = max<int>(min<int>(1.25 * h + sh, maxFaceSize.height), searchMinFaceSize.height);
+
+	// The face left the image or the belief is off, look everywhere
+	if ((searchROI.width < searchMinFaceSize.width) || (searchROI.height < searchMinFaceSize.height))
+	{
+		searchFullFrame();
+	}
+}
+
 void CHumanTracker::generateRegionHistogram(Mat& region, MatND &hist, bool vis)
 {
 	MatND prior = hist.clone();
@@ -586,6 +657,10 @@ void CHumanTracker::detectAndTrackFace()
 	// Do ROI
 	debugFrame = rawFrame.clone();
 	Mat img =  this->rawFrame(searchROI);
+	if (((debugLevel & 0x02) == 0x02) && (searchROI.area() < iWidth * iHeight))
+	{
+		rectangle(debugFrame, searchROI, CV_RGB(0,0,0));
+	}
 
 	faces.clear();
 	ostringstream txtstr;
@@ -597,10 +672,8 @@ void CHumanTracker::detectAndTrackFace()
         CV_RGB(255,255,0),
         CV_RGB(255,0,0),
         CV_RGB(255,0,255)} ;
-    Mat gray;
-    Mat frame( cvRound(img.rows), cvRound(img.cols), CV_8UC1 );
-    cvtColor( img, gray, CV_BGR2GRAY );
-    resize( gray, frame, frame.size(), 0, 0, INTER_LINEAR );
+    Mat frame;
+    cvtColor( img, frame, CV_BGR2GRAY );
     //equalizeHist( frame, frame );
 
 	// This if for internal usage
@@ -609,36 +682,46 @@ void CHumanTracker::detectAndTrackFace()
 	probe = _n;
 
 
-	CvMat _image = frame;
-
-    if (!storage.empty())
-    {
-        cvClearMemStorage(storage);
-    }
-    CvSeq* _objects = cvHaarDetectObjects(&_image, cascade, storage,
-			1.2, initialScoreMin, CV_HAAR_DO_CANNY_PRUNING|CV_HAAR_SCALE_IMAGE, minFaceSize, maxFaceSize);
+    cascade.detect(frame, detections,
+            1.2, initialScoreMin, CV_HAAR_DO_CANNY_PRUNING|CV_HAAR_SCALE_IMAGE, searchMinFaceSize, searchMaxFaceSize);
 
-	vector<CvAvgComp> vecAvgComp;
-	Seq<CvAvgComp>(_objects).copyTo(vecAvgComp);
-
-	// End of using C API
-
-	isFaceInCurrentFrame = (vecAvgComp.size() > 0);
+	isFaceInCurrentFrame = (detections.size() > 0);
 
     // This is a hack
+    // The lost face is looked for as a profile, only around the belief and at about its size
     bool isProfileFace = false;
-    if ((profileHackEnabled) && (!isFaceInCurrentFrame) && ((trackingState == STATE_REJECT) || (trackingState == STATE_REJECT)))
+    if ((profileHackEnabled) && (!isFaceInCurrentFrame) && ((trackingState == STATE_TRACK) || (trackingState == STATE_REJECT)))
     {
         ROS_DEBUG("Using Profile Face hack ...");
 
-        if (!storageProfile.empty()) {
-            cvClearMemStorage(storageProfile);
+        Rect frameRect(0, 0, frame.cols, frame.rows);
+        Rect profileROI = frameRect;
+        Size profileMin = minFaceSize;
+        Size profileMax = maxFaceSize;
+        if (beleif.area() > 0)
+        {
+            // In search ROI coordinates
+            profileROI = Rect(beleif.x - beleif.width - searchROI.x, beleif.y - beleif.height - searchROI.y,
+                              beleif.width * 3, beleif.height * 3);
+            safeRect(profileROI, frameRect);
+            profileMin.width = max<int>(beleif.width * 0.7, minFaceSize.width);
+            profileMin.height = max<int>(beleif.height * 0.7, minFaceSize.height);
+            profileMax.width = max<int>(min<int>(beleif.width * 1.4, maxFaceSize.width), profileMin.width);
+            profileMax.height = max<int>(min<int>(beleif.height * 1.4, maxFaceSize.height), profileMin.height);
+        }
+
+        detections.clear();
+        if ((profileROI.width > 0) && (profileROI.height > 0))
+        {
+            cascadeProfile.detect(frame(profileROI), detections,
+                    1.2, initialScoreMin, CV_HAAR_DO_CANNY_PRUNING|CV_HAAR_SCALE_IMAGE, profileMin, profileMax);
+            for (size_t i = 0; i < detections.size(); i++)
+            {
+                detections[i].rect.x += profileROI.x;
+                detections[i].rect.y += profileROI.y;
+            }
         }
-        CvSeq* _objectsProfile = cvHaarDetectObjects(&_image, cascadeProfile, storageProfile,
-                1.2, initialScoreMin, CV_HAAR_DO_CANNY_PRUNING|CV_HAAR_SCALE_IMAGE, minFaceSize, maxFaceSize);
-        vecAvgComp.clear();
-        Seq<CvAvgComp>(_objectsProfile).copyTo(vecAvgComp);
-        isFaceInCurrentFrame = (vecAvgComp.size() > 0);
+        isFaceInCurrentFrame = (detections.size() > 0);
         if (isFaceInCurrentFrame)
         {
             ROS_DEBUG("The hack seems to work!");
@@ -721,13 +804,13 @@ void CHumanTracker::detectAndTrackFace()
 
 		if (isFaceInCurrentFrame)
 		{
-            //std::cout << vecAvgComp.size() << " detections in image " << std::endl;
+            //std::cout << detections.size() << " detections in image " << std::endl;
 			float minCovNorm = 1e24;
 			int i = 0;
-			for( vector<CvAvgComp>::const_iterator rr = vecAvgComp.begin(); rr != vecAvgComp.end(); rr++, i++ )
+			for( vector<CCascadeDetector::Detection>::const_iterator rr = detections.begin(); rr != detections.end(); rr++, i++ )
 			{
 				copyKalman(KFTracker, MLSearch);
-				CvRect r = rr->rect;
+				Rect r = rr->rect;
 				r.x += searchROI.x;
 				r.y += searchROI.y;
 				double nr = rr->neighbors;
@@ -823,14 +906,6 @@ void CHumanTracker::detectAndTrackFace()
 //            circle(debugFrame, belCenter, belRad + faceUncPos, CV_RGB(255,0,255));
         }
 
-        //searchROI.x = max<int>(belCenter.x - KFTracker.statePost.at<float>(4) * 2, 0);
-        //searchROI.y = max<int>(belCenter.y - KFTracker.statePost.at<float>(5) * 2, 0);
-        //int x2 = min<int>(belCenter.x + KFTracker.statePost.at<float>(4) * 2, iWidth);
-        //int y2 = min<int>(belCenter.y + KFTracker.statePost.at<float>(4) * 2, iHeight);
-		//searchROI.width = x2 - searchROI.x;
-		//searchROI.height = y2 - searchROI.y;
-
-
 		if ((updateFaceHist) && (skinEnabled))
 		{
             //updateFaceHist is true when we see a real face (not all the times)
@@ -864,6 +939,9 @@ void CHumanTracker::detectAndTrackFace()
 //    }
 
 //	dt =  ((double) getTickCount() - t) / ((double) getTickFrequency()); // In Seconds
+
+	// Where to look in the next frame
+	updateSearchROI(dt);
 }
 
 void CHumanTracker::trackSkin()
@@ -1322,6 +1400,19 @@ int main(int argc, char **argv)
     ros::param::param("~flowstablize_mode", p_stablization, 0);
     ROS_INFO("Flow Stablization is %d", p_stablization);
 
+    // 0 is one scale band per CPU
+    int p_detectorThreads;
+    ros::param::param("~detector_threads", p_detectorThreads, 0);
+    ROS_INFO("Detector threads is %d", p_detectorThreads);
+
+    bool p_roiSearchEnabled;
+    int p_fullSweepFrames;
+    double p_roiSigma;
+    ros::param::param("~roi_search_enabled", p_roiSearchEnabled, false);
+    ros::param::param("~full_sweep_frames", p_fullSweepFrames, 10);
+    ros::param::param("~roi_sigma", p_roiSigma, 3.0);
+    ROS_INFO("ROI Search is %s, full frame every %d frames", p_roiSearchEnabled ? "Enabled" : "Disabled", p_fullSweepFrames);
+
     int  p_debugMode;
     ros::param::param("~debug_mode", p_debugMode, 0x02);
     ROS_INFO("Debug mode is %x", p_debugMode);
@@ -1365,7 +1456,8 @@ int main(int argc, char **argv)
                                p_minFaceSizeW, p_minFaceSizeH, p_maxFaceSizeW, p_maxFaceSizeH,
                                p_initialScoreMin, p_initialDetectFrames, p_initialRejectFrames, p_minFlow,
                                p_profileFaceEnabled, p_skinEnabled, p_gestureEnabled,
-                               p_debugMode, p_stablization,
+                               p_debugMode, p_stablization, p_detectorThreads,
+                               p_roiSearchEnabled, p_fullSweepFrames, p_roiSigma,
                                facePub, allDetectionsPub, debugPub, skinPub, opticalPub);
 
     image_transport::Subscriber visionSub = it.subscribe("input_rgb_image", 1, &CHumanTracker::visionCallback, &humanTracker);
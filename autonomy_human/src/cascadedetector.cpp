@@ -0,0 +1,140 @@
+#include "cascadedetector.h"
+#include <algorithm>
+
+#define GROUP_EPS 0.2
+
+class CCascadeDetector::BandInvoker : public cv::ParallelLoopBody
+{
+private:
+    CCascadeDetector& detector;
+    const cv::Mat& gray;
+    double scaleFactor;
+    int flags;
+
+public:
+    BandInvoker(CCascadeDetector& _detector, const cv::Mat& _gray, double _scaleFactor, int _flags)
+        : detector(_detector)
+        , gray(_gray)
+        , scaleFactor(_scaleFactor)
+        , flags(_flags)
+    {
+    }
+
+    virtual void operator()(const cv::Range& range) const
+    {
+        // No grouping here, the hits of all bands are grouped together
+        for (int i = range.start; i < range.end; i++)
+        {
+            detector.classifiers[i].detectMultiScale(gray, detector.bandHits[i], scaleFactor, 0, flags,
+                                                     detector.bandMin[i], detector.bandMax[i]);
+        }
+    }
+};
+
+CCascadeDetector::CCascadeDetector()
+{
+}
+
+bool CCascadeDetector::load(const std::string& file, int bands)
+{
+    if (bands < 1) bands = cv::getNumberOfCPUs();
+
+    // Each band gets its own copy: copies of a classifier share their data
+    classifiers.clear();
+    classifiers.resize(bands);
+    for (int i = 0; i < bands; i++)
+    {
+        if (!classifiers[i].load(file))
+        {
+            classifiers.clear();
+            return false;
+        }
+    }
+
+    window = classifiers[0].getOriginalWindowSize();
+    return true;
+}
+
+bool CCascadeDetector::empty() const
+{
+    return classifiers.empty() || classifiers[0].empty();
+}
+
+bool CCascadeDetector::isOldFormat() const
+{
+    return !empty() && classifiers[0].isOldFormatCascade();
+}
+
+void CCascadeDetector::planBands(const cv::Size& image, double scaleFactor, cv::Size minSize, cv::Size maxSize)
+{
+    bandMin.clear();
+    bandMax.clear();
+    if (scaleFactor <= 1.0) return;
+
+    if (maxSize.width <= 0 || maxSize.height <= 0) maxSize = image;
+
+    // The same window sizes detectMultiScale steps through
+    std::vector<cv::Size> windows;
+    std::vector<double> cost;
+    double total = 0.0;
+    for (double factor = 1.0; ; factor *= scaleFactor)
+    {
+        cv::Size w(cvRound(window.width * factor), cvRound(window.height * factor));
+        if ((w.width > maxSize.width) || (w.height > maxSize.height) ||
+            (w.width > image.width) || (w.height > image.height)) break;
+        if ((w.width < minSize.width) || (w.height < minSize.height)) continue;
+
+        // Windows of the scaled down image
+        double c = (double) (image.width - w.width + 1) * (image.height - w.height + 1) / (factor * factor);
+        windows.push_back(w);
+        cost.push_back(c);
+        total += c;
+    }
+
+    const size_t bands = std::min(classifiers.size(), windows.size());
+    size_t first = 0;
+    double acc = 0.0;
+    for (size_t k = 0; k < windows.size(); k++)
+    {
+        acc += cost[k];
+        bool last = (k + 1 == windows.size());
+        if (last || (acc >= total * (bandMin.size() + 1) / bands))
+        {
+            bandMin.push_back(windows[first]);
+            bandMax.push_back(windows[k]);
+            first = k + 1;
+        }
+    }
+}
+
+void CCascadeDetector::detect(const cv::Mat& gray, std::vector<Detection>& detections,
+                              double scaleFactor, int minNeighbors, int flags,
+                              cv::Size minSize, cv::Size maxSize)
+{
+    detections.clear();
+    if (empty()) return;
+
+    planBands(gray.size(), scaleFactor, minSize, maxSize);
+    const int bands = bandMin.size();
+    bandHits.resize(bands);
+
+    BandInvoker invoker(*this, gray, scaleFactor, flags);
+    if (bands > 1)
+        cv::parallel_for_(cv::Range(0, bands), invoker);
+    else if (bands == 1)
+        invoker(cv::Range(0, 1));
+
+    hits.clear();
+    for (int i = 0; i < bands; i++)
+        hits.insert(hits.end(), bandHits[i].begin(), bandHits[i].end());
+
+    // As cvHaarDetectObjects: neighbors is the size of the group
+    cv::groupRectangles(hits, neighbors, std::max(minNeighbors, 1), GROUP_EPS);
+
+    detections.resize(hits.size());
+    for (size_t i = 0; i < hits.size(); i++)
+    {
+        detections[i].rect = hits[i];
+        detections[i].neighbors = neighbors[i];
+    }
+}
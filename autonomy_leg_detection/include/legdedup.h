@@ -0,0 +1,65 @@
+#ifndef LEGDEDUP_H
+#define LEGDEDUP_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+#include <geometry_msgs/PoseArray.h>
+
+/*
+ * Merges the leg candidates of one scan (pattern legs, tracked legs and
+ * persons) that lie within the merge radius of each other, keeping the most
+ * confident one of every group. Candidates are taken by confidence, then in
+ * the order they were added, and one is kept unless a kept leg is closer
+ * than the radius. The kept legs are binned into a hash grid with cells of
+ * one radius, so each candidate is only compared with its 3x3 neighbourhood:
+ * expected O(n) for bounded density. The cell key, hash and probing are
+ * the ones of CSpatialCluster in likelihood_grid, keep the two the same.
+ */
+
+enum LegConfidence_t
+{
+    LEG_CONFIDENCE_TRACKED_LEG = 0,     // single leg of the tracker
+    LEG_CONFIDENCE_PATTERN,             // leg pair seen in this scan
+    LEG_CONFIDENCE_PERSON,              // person of the tracker
+    LEG_CONFIDENCE_LEVELS
+};
+
+class CLegDedup
+{
+private:
+    float radius_;          // [m]
+
+    struct Candidate_t{
+        float x;
+        float y;
+    };
+
+    struct Bucket_t{
+        uint64_t key;
+        int head;           // first kept leg in the cell, -1 if the bucket is free
+    };
+
+    std::vector<Candidate_t> candidates_[LEG_CONFIDENCE_LEVELS];
+    std::vector<Candidate_t> kept_;
+    std::vector<Bucket_t> table_;
+    std::vector<int> next_;         // next kept leg in the same cell
+    size_t mask_;
+
+    static uint64_t cellKey(int64_t cx, int64_t cy) {return ((uint64_t) cx << 32) ^ (uint32_t) cy;}
+    size_t findBucket(uint64_t key) const;
+
+public:
+    CLegDedup(float radius = 0.2);
+
+    void setRadius(float radius) {radius_ = radius;}
+    float radius() const {return radius_;}
+
+    void clear();
+    void add(float x, float y, LegConfidence_t confidence);
+
+    // appends the kept legs to legs.poses, returns their number
+    size_t dedup(geometry_msgs::PoseArray& legs);
+};
+
+#endif // LEGDEDUP_H
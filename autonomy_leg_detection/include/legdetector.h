@@ -0,0 +1,77 @@
+#ifndef LEGDETECTOR_H
+#define LEGDETECTOR_H
+
+#include <ros/ros.h>
+#include <sensor_msgs/LaserScan.h>
+#include <geometry_msgs/PoseArray.h>
+#include <visualization_msgs/Marker.h>
+#include <nav_msgs/Odometry.h>
+#include <atomic>
+#include <miarn/feature_geometry.h>
+#include <miarn/feature_person.h>
+#include "scanfrontend.h"
+#include "scansegmenter.h"
+#include "scanbackground.h"
+#include "legdedup.h"
+
+/*
+ * The leg detection pipeline of one laser: segmentation, arc fit and leg
+ * shape features (CScanSegmenter), the leg candidates of miarn and of
+ * findLegPatterns, the miarn leg/person tracker and the final dedup
+ * (CLegDedup). All of its state lives in the instance, so any number of
+ * detectors can run side by side, each on its own thread.
+ */
+
+class CLegDetector
+{
+public:
+    // wall time of each stage of the last detect() [s]
+    struct StageTimes_t{
+        double convert;     // front end
+        double segment;     // background mask and segmentation
+        double features;    // leg candidates of miarn and findLegPatterns
+        double track;       // leg/person tracker and background learning
+        double dedup;
+    };
+
+private:
+    LaserFeatureX laser_feature_;
+    FeatureLegTracker leg_tracker_;
+    CScanFrontEnd scan_front_end_;
+    CScanSegmenter segmenter_;
+
+    // static background, learned and masked only while the robot stands still
+    CScanBackground background_;
+    bool background_enable_;
+    float stationary_linear_;       // [m/s]
+    float stationary_angular_;      // [rad/s]
+    std::atomic<bool> stationary_;
+    float track_radius_;            // [mm] beams this close to a leg track are not background
+    std::vector<uint8_t> near_tracks_;  // beams of the last scan near its leg tracks
+    geometry_msgs::PoseArray pattern_legs_;     // found by findLegPatterns
+    CLegDedup dedup_;
+    StageTimes_t stage_times_;
+
+    bool legPair(const LegSegment_t& right, const LegSegment_t& left, const float* x, const float* y);
+    void addProbableLeg(const LegSegment_t& segment, const float* x, const float* y);
+    bool findLegPatterns(const float* x, const float* y);
+    void markTracks(const sensor_msgs::LaserScan& scan);
+
+public:
+    CLegDetector();
+
+    // laserFeature/... and featureLegTracker/... parameters of the private namespace
+    void init(const ros::NodeHandle& private_n);
+
+    // legs of the scan in the scan frame [m]; false for an empty scan
+    bool detect(const sensor_msgs::LaserScan& scan, geometry_msgs::PoseArray& legs);
+
+    const StageTimes_t& stageTimes() const {return stage_times_;}
+
+    bool backgroundEnabled() const {return background_enable_;}
+    void updateOdometry(const nav_msgs::Odometry::ConstPtr& msg);
+
+    static void legMarker(const geometry_msgs::PoseArray& legs, double scale, visualization_msgs::Marker& marker);
+};
+
+#endif // LEGDETECTOR_H
@@ -0,0 +1,66 @@
+#ifndef MULTILEGDETECTOR_H
+#define MULTILEGDETECTOR_H
+
+#include <string>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include <boost/shared_ptr.hpp>
+#include <tf/transform_listener.h>
+#include "legdetector.h"
+
+/*
+ * Leg detection over several lasers (front and rear scanner): one
+ * CLegDetector per scan topic, the callbacks run in parallel on the threads
+ * of an AsyncSpinner. The legs of every scanner are moved into base_frame with
+ * the scanner's extrinsic, looked up once per scan frame and then kept, and
+ * the latest legs of all scanners are merged into one legs message stamped
+ * with the newest scan. A leg seen by two scanners is published once; legs
+ * of the same scanner are never merged, its detector has done that already.
+ */
+
+class CMultiLegDetector
+{
+private:
+    struct Scanner_t{
+        std::string topic;
+        CLegDetector detector;
+        ros::Subscriber sub;
+
+        // cached extrinsic, base_frame <- frame
+        std::string frame;
+        bool has_extrinsic;
+        float cos_yaw, sin_yaw, x, y;
+
+        geometry_msgs::PoseArray detected;  // scan frame
+        geometry_msgs::PoseArray legs;      // base_frame, guarded by mutex_
+        ros::Time stamp;
+    };
+
+    ros::NodeHandle n_;
+    tf::TransformListener tf_listener_;
+    ros::Subscriber odom_sub_;
+    ros::Publisher leg_pub_;
+    ros::Publisher marker_pub_;
+    std::string base_frame_;
+    float merge_distance_;          // [m] legs of two different scanners closer than this are one
+    float max_age_;                 // [s] legs of a scanner older than this are left out
+    bool show_marker_;
+    double marker_scale_;
+
+    std::vector<boost::shared_ptr<Scanner_t> > scanners_;
+    boost::mutex mutex_;
+    geometry_msgs::PoseArray merged_;
+
+    bool updateExtrinsic(Scanner_t& scanner, const std::string& frame);
+    void laserCallBack(const sensor_msgs::LaserScan::ConstPtr& msg, size_t index);
+    void publishMerged();
+    void odometryCallBack(const nav_msgs::Odometry::ConstPtr& msg);
+
+public:
+    CMultiLegDetector(ros::NodeHandle n, const ros::NodeHandle& private_n,
+                      const std::vector<std::string>& topics);
+
+    size_t size() const {return scanners_.size();}
+};
+
+#endif // MULTILEGDETECTOR_H
@@ -0,0 +1,56 @@
+#ifndef SCANBACKGROUND_H
+#define SCANBACKGROUND_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+/*
+ * Static background of a laser, learned while the robot stands still: a
+ * running median per beam (every scan moves it one step towards the range
+ * seen), started from the true median of the first learn_scans scans. A beam
+ * is masked out of the segmentation once its range has stayed within
+ * tolerance of the median for stable_scans scans in a row: walls, furniture
+ * and door frames. People passing by barely move the median and reset the
+ * count of the beams they cross; someone standing still long enough becomes
+ * background, unless the caller excludes the beams around its leg tracks.
+ *
+ * learn() is meant to be fed each scan after it was masked, so that a scan is
+ * never masked by a model it is part of.
+ */
+
+class CScanBackground
+{
+private:
+    float tolerance_;       // [mm]
+    float step_;            // [mm] median step per scan
+    uint32_t learn_scans_;  // scans learned before the median is seeded
+    uint32_t stable_scans_; // scans a beam matches its median before it is masked
+    uint32_t scans_;
+
+    std::vector<float> seed_;       // beam-major, learn_scans_ per beam
+    std::vector<uint32_t> seeded_;  // ranges in seed_ per beam
+    std::vector<float> median_;
+    std::vector<uint32_t> stable_;  // consecutive scans within tolerance
+    std::vector<uint8_t> mask_;
+    size_t masked_;
+
+    void seed(size_t n);
+
+public:
+    CScanBackground();
+
+    void setParams(float tolerance, float step, uint32_t learn_scans, uint32_t stable_scans);
+    void reset();
+
+    // beams with exclude[i] != 0 are left out, exclude may be NULL
+    void learn(const float* ranges, const uint8_t* exclude, size_t n);
+
+    bool ready() const {return scans_ >= learn_scans_ && !median_.empty();}
+
+    // background beams of the scan (1 = masked), NULL until ready; excluded beams are never masked
+    const uint8_t* mask(const float* ranges, const uint8_t* exclude, size_t n);
+    size_t masked() const {return masked_;}
+};
+
+#endif // SCANBACKGROUND_H
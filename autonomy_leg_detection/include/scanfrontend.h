@@ -0,0 +1,43 @@
+#ifndef SCANFRONTEND_H
+#define SCANFRONTEND_H
+
+#include <vector>
+#include <cstddef>
+#include <sensor_msgs/LaserScan.h>
+
+/*
+ * Turns a laser scan into clamped ranges and cartesian points. The sin/cos of
+ * the beams are computed once per scan geometry (angle_min, angle_increment,
+ * number of beams) and kept; the conversion runs four beams at a time with
+ * SSE2 into buffers that are only reallocated when the geometry changes.
+ */
+
+class CScanFrontEnd
+{
+private:
+    double angle_min_;
+    double angle_increment_;
+    size_t beams_;
+
+    std::vector<float> cos_;
+    std::vector<float> sin_;
+    std::vector<float> ranges_;
+    std::vector<float> x_;
+    std::vector<float> y_;
+
+    void updateTables(const sensor_msgs::LaserScan& scan);
+
+public:
+    CScanFrontEnd();
+
+    // ranges clamped to [range_min, range_max], invalid ones to range_max,
+    // everything multiplied by scale
+    void convert(const sensor_msgs::LaserScan& scan, float scale);
+
+    size_t size() const {return beams_;}
+    const float* ranges() const {return &ranges_[0];}
+    const float* x() const {return &x_[0];}
+    const float* y() const {return &y_[0];}
+};
+
+#endif // SCANFRONTEND_H
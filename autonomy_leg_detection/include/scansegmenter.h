@@ -0,0 +1,66 @@
+#ifndef SCANSEGMENTER_H
+#define SCANSEGMENTER_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+/*
+ * Jump-distance segmentation of a scan and the leg-shape features of every
+ * segment, on the buffers of CScanFrontEnd [mm].
+ *
+ * One SSE2 pass over the beams flags the breakpoints (consecutive points
+ * further apart than the jump threshold, or a beam without return) and the
+ * sign of the range slope; one scalar pass walks the flags into the segment
+ * table, which keeps its capacity from scan to scan. Widths, the slope sign
+ * pattern and the inscribed angle arc fit are computed once per segment.
+ */
+
+struct LegSegment_t{
+    uint32_t begin;
+    uint32_t end;
+    uint32_t mid;
+    uint32_t size;
+    float width;            // begin - end [mm]
+    float mid_begin;        // mid - begin [mm]
+    float mid_end;          // mid - end [mm]
+    uint32_t sign_changes;  // of the range slope along the segment
+    bool first_fall;        // the range falls from the first beam
+    bool last_rise;         // and rises to the last one
+    float arc_mean;         // inscribed angle [rad]
+    float arc_std;
+    bool arc;               // inscribed angle within the aperture limits
+};
+
+class CScanSegmenter
+{
+private:
+    float jump_threshold_;      // [mm]
+    float arc_min_aperture_;    // [rad]
+    float arc_max_aperture_;
+    float arc_std_max_;
+
+    std::vector<uint8_t> breaks_;       // beam i and i+1 are in different segments
+    std::vector<uint8_t> rise_;         // range rises from beam i to i+1
+    std::vector<uint32_t> changes_;     // slope sign changes before beam i
+    std::vector<LegSegment_t> segments_;
+    size_t count_;
+
+    void addSegment(uint32_t begin, uint32_t end, const float* x, const float* y);
+    void fitArc(LegSegment_t& s, const float* x, const float* y);
+
+public:
+    CScanSegmenter();
+
+    void setParams(float jump_threshold, float arc_min_aperture, float arc_max_aperture, float arc_std_max);
+
+    // n beams of CScanFrontEnd; beams at max_range [mm] have no return and
+    // masked beams (mask[i] != 0) are left out the same way
+    size_t segment(const float* ranges, const float* x, const float* y, size_t n, float max_range,
+                   const uint8_t* mask = NULL);
+
+    size_t size() const {return count_;}
+    const LegSegment_t& operator[](size_t i) const {return segments_[i];}
+};
+
+#endif // SCANSEGMENTER_H
@@ -0,0 +1,83 @@
+#ifndef SCANSIMULATOR_H
+#define SCANSIMULATOR_H
+
+#include <vector>
+#include <cstddef>
+#include <boost/random/mersenne_twister.hpp>
+#include <sensor_msgs/LaserScan.h>
+#include <geometry_msgs/PoseArray.h>
+
+/*
+ * Synthetic laser scans with ground truth for the leg detection benchmark:
+ * a laser in the middle of a room with walls, clutter (poles, chair and
+ * table legs, bins) and people walking around with a simple gait, each leg
+ * a circle swinging back and forth along the heading. Every scan is ray
+ * cast against all of them and gets gaussian range noise. The truth is the
+ * centre of the people that enough beams hit, in the scan frame [m].
+ */
+
+class CScanSimulator
+{
+public:
+    struct Params_t{
+        size_t beams;
+        float fov;              // [rad], centred on the x axis
+        float range_max;        // [m]
+        float rate;             // [Hz]
+        float noise;            // [m] range standard deviation
+        float room_x;           // [m] half size of the room
+        float room_y;
+        size_t people;
+        size_t clutter;
+        size_t min_hits;        // beams on a person for it to be visible
+    };
+
+private:
+    struct Circle_t{
+        float x;
+        float y;
+        float r;
+    };
+
+    struct Segment_t{
+        float x0;
+        float y0;
+        float x1;
+        float y1;
+    };
+
+    struct Person_t{
+        float x;
+        float y;
+        float vx;
+        float vy;
+        float phase;            // [rad] of the gait
+    };
+
+    Params_t params_;
+    boost::mt19937 rng_;
+    uint32_t seq_;
+
+    std::vector<Segment_t> walls_;
+    std::vector<Circle_t> clutter_;
+    std::vector<Person_t> people_;
+    std::vector<Circle_t> legs_;        // two per person, this scan
+    std::vector<size_t> hits_;
+
+    float uniform(float a, float b);
+    void legsOf(const Person_t& person, Circle_t& right, Circle_t& left) const;
+    void walk(Person_t& person, float dt);
+
+    // range of the ray (c, s) from the origin, and the leg it hits (-1 if none)
+    float castRay(float c, float s, int& leg) const;
+
+public:
+    CScanSimulator();
+
+    static Params_t defaultParams();
+
+    void reset(const Params_t& params, unsigned int seed);
+    void step(sensor_msgs::LaserScan& scan, geometry_msgs::PoseArray& truth);
+};
+
+#endif // SCANSIMULATOR_H
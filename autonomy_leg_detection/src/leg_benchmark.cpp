@@ -0,0 +1,272 @@
+#include <ros/ros.h>
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+#include <sensor_msgs/LaserScan.h>
+#include <geometry_msgs/PoseArray.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include "legdetector.h"
+#include "scansimulator.h"
+
+/*
+ * Offline benchmark of the leg detection: replays a corpus of laser scans
+ * through CLegDetector as fast as it goes and reports scans/s, the latency of
+ * every stage and the precision/recall against the ground truth, so speed-ups
+ * can be checked not to cost detections.
+ *
+ * The corpus is a bag (~bag, ~scan_topic and optionally ~truth_topic, a
+ * PoseArray of the people in the scan frame [m]) or, without a bag, ~scans
+ * scans of CScanSimulator. The detector reads the same parameters as
+ * leg_detection from the private namespace, e.g.
+ *
+ *   rosrun autonomy_leg_detection leg_benchmark _scans:=5000 _people:=4
+ *   rosrun autonomy_leg_detection leg_benchmark _bag:=hall.bag _scan_topic:=/scan_filtered
+ *
+ * A detection is right if a person is within ~match_radius, a person is
+ * found if any detection is within ~match_radius.
+ */
+
+struct Frame_t{
+    sensor_msgs::LaserScan::ConstPtr scan;
+    geometry_msgs::PoseArray truth;
+    bool has_truth;
+};
+
+struct Score_t{
+    size_t detections;
+    size_t right_detections;
+    size_t people;
+    size_t found_people;
+};
+
+enum Stage_t
+{
+    STAGE_CONVERT = 0,
+    STAGE_SEGMENT,
+    STAGE_FEATURES,
+    STAGE_TRACK,
+    STAGE_DEDUP,
+    STAGE_TOTAL,
+    STAGES
+};
+
+const char* stage_names[STAGES] = {"convert", "segment", "features", "track", "dedup", "total"};
+
+std::string globalTopic(const std::string& topic)
+{
+    if(topic.empty() || topic[0] == '/') return topic;
+    return "/" + topic;
+}
+
+bool loadBag(const std::string& path, const std::string& scan_topic, const std::string& truth_topic,
+             std::vector<Frame_t>& frames)
+{
+    rosbag::Bag bag;
+    try
+    {
+        bag.open(path, rosbag::bagmode::Read);
+    }
+    catch(rosbag::BagException& e)
+    {
+        ROS_FATAL("Can not open %s: %s", path.c_str(), e.what());
+        return false;
+    }
+
+    std::vector<std::string> topics;
+    topics.push_back(globalTopic(scan_topic));
+    if(!truth_topic.empty()) topics.push_back(globalTopic(truth_topic));
+
+    /* Each scan is scored against the last truth before it */
+    geometry_msgs::PoseArray truth;
+    bool has_truth = false;
+
+    rosbag::View view(bag, rosbag::TopicQuery(topics));
+    for(rosbag::View::iterator it = view.begin(); it != view.end(); ++it)
+    {
+        if(!truth_topic.empty() && it->getTopic() == globalTopic(truth_topic))
+        {
+            geometry_msgs::PoseArray::ConstPtr msg = it->instantiate<geometry_msgs::PoseArray>();
+            if(msg)
+            {
+                truth = *msg;
+                has_truth = true;
+            }
+            continue;
+        }
+
+        sensor_msgs::LaserScan::ConstPtr scan = it->instantiate<sensor_msgs::LaserScan>();
+        if(!scan || scan->ranges.empty()) continue;
+
+        Frame_t frame;
+        frame.scan = scan;
+        frame.truth = truth;
+        frame.has_truth = has_truth;
+        frames.push_back(frame);
+    }
+
+    bag.close();
+    ROS_INFO("Loaded %zu scans from %s", frames.size(), path.c_str());
+    return true;
+}
+
+void simulate(const ros::NodeHandle& private_n, size_t scans, std::vector<Frame_t>& frames)
+{
+    CScanSimulator::Params_t params = CScanSimulator::defaultParams();
+    int beams, people, clutter, seed;
+    double fov, noise;
+    private_n.param("beams", beams, (int) params.beams);
+    private_n.param("fov", fov, (double) params.fov);
+    private_n.param("noise", noise, (double) params.noise);
+    private_n.param("people", people, (int) params.people);
+    private_n.param("clutter", clutter, (int) params.clutter);
+    private_n.param("seed", seed, 1);
+    params.beams = beams;
+    params.fov = fov;
+    params.noise = noise;
+    params.people = people;
+    params.clutter = clutter;
+
+    CScanSimulator simulator;
+    simulator.reset(params, seed);
+
+    frames.resize(scans);
+    for(size_t i = 0; i < scans; i++)
+    {
+        sensor_msgs::LaserScan::Ptr scan(new sensor_msgs::LaserScan);
+        simulator.step(*scan, frames[i].truth);
+        frames[i].scan = scan;
+        frames[i].has_truth = true;
+    }
+
+    ROS_INFO("Simulated %zu scans of %d beams, %d people and %d clutter objects", scans, beams, people, clutter);
+}
+
+void score(const geometry_msgs::PoseArray& legs, const geometry_msgs::PoseArray& truth,
+           float match_radius, Score_t& s)
+{
+    const float radius2 = match_radius * match_radius;
+    std::vector<bool> found(truth.poses.size(), false);
+
+    for(size_t i = 0; i < legs.poses.size(); i++)
+    {
+        bool right = false;
+        for(size_t j = 0; j < truth.poses.size(); j++)
+        {
+            const float ex = legs.poses[i].position.x - truth.poses[j].position.x;
+            const float ey = legs.poses[i].position.y - truth.poses[j].position.y;
+            if(ex * ex + ey * ey < radius2)
+            {
+                right = true;
+                found[j] = true;
+            }
+        }
+        if(right) s.right_detections++;
+    }
+
+    s.detections += legs.poses.size();
+    s.people += truth.poses.size();
+    s.found_people += std::count(found.begin(), found.end(), true);
+}
+
+void reportStage(const char* name, std::vector<double>& times)
+{
+    if(times.empty()) return;
+    std::sort(times.begin(), times.end());
+
+    double sum = 0.0;
+    for(size_t i = 0; i < times.size(); i++) sum += times[i];
+
+    const size_t p99 = std::min(times.size() - 1, times.size() * 99 / 100);
+    ROS_INFO("%-9s mean %8.1f us  p50 %8.1f us  p99 %8.1f us  max %8.1f us", name,
+             1e6 * sum / times.size(), 1e6 * times[times.size() / 2], 1e6 * times[p99], 1e6 * times.back());
+}
+
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "leg_benchmark", ros::init_options::AnonymousName | ros::init_options::NoRosout);
+    if(!ros::master::check())
+    {
+        ROS_FATAL("leg_benchmark reads its parameters from the parameter server, start a roscore first");
+        return 1;
+    }
+
+    ros::NodeHandle private_n("~");
+
+    std::string bag, scan_topic, truth_topic;
+    int scans, repeat;
+    double match_radius;
+    private_n.param("bag", bag, std::string(""));
+    private_n.param("scan_topic", scan_topic, std::string("scan"));
+    private_n.param("truth_topic", truth_topic, std::string(""));
+    private_n.param("scans", scans, 2000);
+    private_n.param("repeat", repeat, 1);
+    private_n.param("match_radius", match_radius, 0.5);
+
+    /* The whole corpus is in memory before the clock starts */
+    std::vector<Frame_t> frames;
+    if(!bag.empty())
+    {
+        if(!loadBag(bag, scan_topic, truth_topic, frames)) return 1;
+    }
+    else simulate(private_n, std::max(scans, 0), frames);
+
+    if(frames.empty())
+    {
+        ROS_FATAL("No scans to replay");
+        return 1;
+    }
+
+    CLegDetector detector;
+    detector.init(private_n);
+
+    std::vector<double> times[STAGES];
+    for(int i = 0; i < STAGES; i++) times[i].reserve(frames.size() * std::max(repeat, 1));
+
+    Score_t s = {0, 0, 0, 0};
+    bool scored = false;
+    geometry_msgs::PoseArray legs;
+    double elapsed = 0.0;
+
+    for(int r = 0; r < std::max(repeat, 1); r++)
+    {
+        for(size_t i = 0; i < frames.size(); i++)
+        {
+            ros::WallTime start = ros::WallTime::now();
+            detector.detect(*frames[i].scan, legs);
+            const double total = (ros::WallTime::now() - start).toSec();
+            elapsed += total;
+
+            const CLegDetector::StageTimes_t& stage = detector.stageTimes();
+            times[STAGE_CONVERT].push_back(stage.convert);
+            times[STAGE_SEGMENT].push_back(stage.segment);
+            times[STAGE_FEATURES].push_back(stage.features);
+            times[STAGE_TRACK].push_back(stage.track);
+            times[STAGE_DEDUP].push_back(stage.dedup);
+            times[STAGE_TOTAL].push_back(total);
+
+            if(frames[i].has_truth)
+            {
+                score(legs, frames[i].truth, match_radius, s);
+                scored = true;
+            }
+        }
+    }
+
+    const size_t replayed = times[STAGE_TOTAL].size();
+    ROS_INFO("%zu scans in %.3f s: %.1f scans/s", replayed, elapsed, (elapsed > 0.0) ? replayed / elapsed : 0.0);
+    for(int i = 0; i < STAGES; i++)
+        reportStage(stage_names[i], times[i]);
+
+    if(scored)
+    {
+        ROS_INFO("precision %.3f (%zu of %zu detections), recall %.3f (%zu of %zu people), %.2f detections/scan",
+                 s.detections ? (double) s.right_detections / s.detections : 0.0, s.right_detections, s.detections,
+                 s.people ? (double) s.found_people / s.people : 0.0, s.found_people, s.people,
+                 (double) s.detections / replayed);
+    }
+    else ROS_INFO("No ground truth, precision and recall not scored");
+
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+#include "legdetector.h"
+
+namespace autonomy_leg_detection
+{
+
+/*
+ * The leg detector as a nodelet. Scans from a laser driver in the same
+ * manager arrive as shared pointers without being copied, and every instance
+ * has a detector of its own, so the manager's threads process several lasers
+ * concurrently.
+ */
+class LegDetectionNodelet : public nodelet::Nodelet
+{
+private:
+    CLegDetector detector_;
+    ros::Subscriber laser_sub_;
+    ros::Subscriber odom_sub_;
+    ros::Publisher leg_pub_;
+    ros::Publisher marker_pub_;
+    bool show_marker_;
+    double marker_scale_;
+
+    virtual void onInit()
+    {
+        ros::NodeHandle& n = getNodeHandle();
+        ros::NodeHandle& private_n = getPrivateNodeHandle();
+
+        detector_.init(private_n);
+        private_n.param("show_marker", show_marker_, true);
+        private_n.param("marker_scale", marker_scale_, 0.5);
+
+        leg_pub_ = n.advertise<geometry_msgs::PoseArray>("legs", 10);
+        marker_pub_ = n.advertise<visualization_msgs::Marker>("leg/marker", 1);
+        laser_sub_ = n.subscribe("scan", 10, &LegDetectionNodelet::laserCallBack, this);
+        if(detector_.backgroundEnabled())
+            odom_sub_ = n.subscribe("husky/odom", 10, &LegDetectionNodelet::odometryCallBack, this);
+    }
+
+    void odometryCallBack(const nav_msgs::Odometry::ConstPtr& msg)
+    {
+        detector_.updateOdometry(msg);
+    }
+
+    void laserCallBack(const sensor_msgs::LaserScan::ConstPtr& msg)
+    {
+        // published as a pointer, so nodelets of the same manager get it without a copy
+        geometry_msgs::PoseArrayPtr legs(new geometry_msgs::PoseArray);
+        if(!detector_.detect(*msg, *legs)) return;
+        leg_pub_.publish(legs);
+
+        if(show_marker_ && marker_pub_.getNumSubscribers() > 0)
+        {
+            visualization_msgs::Marker marker;
+            CLegDetector::legMarker(*legs, marker_scale_, marker);
+            marker_pub_.publish(marker);
+        }
+    }
+};
+
+}
+
+PLUGINLIB_EXPORT_CLASS(autonomy_leg_detection::LegDetectionNodelet, nodelet::Nodelet)
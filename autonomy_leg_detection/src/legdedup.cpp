@@ -0,0 +1,103 @@
+#include "legdedup.h"
+#include <ros/ros.h>
+#include <cmath>
+
+CLegDedup::CLegDedup(float radius):
+    radius_(radius),
+    mask_(0)
+{
+}
+
+size_t CLegDedup::findBucket(uint64_t key) const
+{
+    /* Linear probing, stops at the key or at a free bucket */
+    size_t h = (size_t) (key * 0x9E3779B97F4A7C15ULL >> 32) & mask_;
+    while(table_[h].head >= 0 && table_[h].key != key)
+        h = (h + 1) & mask_;
+    return h;
+}
+
+void CLegDedup::clear()
+{
+    for(int i = 0; i < LEG_CONFIDENCE_LEVELS; i++)
+        candidates_[i].clear();
+}
+
+void CLegDedup::add(float x, float y, LegConfidence_t confidence)
+{
+    ROS_ASSERT(confidence >= 0 && confidence < LEG_CONFIDENCE_LEVELS);
+    Candidate_t c = {x, y};
+    candidates_[confidence].push_back(c);
+}
+
+size_t CLegDedup::dedup(geometry_msgs::PoseArray& legs)
+{
+    ROS_ASSERT(radius_ > 0.0);
+
+    size_t n = 0;
+    for(int i = 0; i < LEG_CONFIDENCE_LEVELS; i++)
+        n += candidates_[i].size();
+
+    kept_.clear();
+    if(n == 0) return 0;
+
+    /* At most half full */
+    size_t buckets = 16;
+    while(buckets < 2 * n) buckets <<= 1;
+    Bucket_t free_bucket = {0, -1};
+    table_.assign(buckets, free_bucket);
+    mask_ = buckets - 1;
+    next_.clear();
+
+    const float inv_radius = 1.0 / radius_;
+    const float radius2 = radius_ * radius_;
+
+    /* The most confident level first, so each group keeps its best leg */
+    for(int level = LEG_CONFIDENCE_LEVELS - 1; level >= 0; level--)
+    {
+        const std::vector<Candidate_t>& candidates = candidates_[level];
+        for(size_t i = 0; i < candidates.size(); i++)
+        {
+            const Candidate_t& c = candidates[i];
+            int64_t cx = (int64_t) floorf(c.x * inv_radius);
+            int64_t cy = (int64_t) floorf(c.y * inv_radius);
+
+            bool duplicate = false;
+            for(int64_t dx = -1; dx <= 1 && !duplicate; dx++)
+            {
+                for(int64_t dy = -1; dy <= 1 && !duplicate; dy++)
+                {
+                    size_t b = findBucket(cellKey(cx + dx, cy + dy));
+                    for(int j = table_[b].head; j >= 0; j = next_[j])
+                    {
+                        float ex = c.x - kept_[j].x;
+                        float ey = c.y - kept_[j].y;
+                        if(ex * ex + ey * ey < radius2)
+                        {
+                            duplicate = true;
+                            break;
+                        }
+                    }
+                }
+            }
+            if(duplicate) continue;
+
+            size_t b = findBucket(cellKey(cx, cy));
+            table_[b].key = cellKey(cx, cy);
+            next_.push_back(table_[b].head);
+            table_[b].head = (int) kept_.size();
+            kept_.push_back(c);
+        }
+    }
+
+    geometry_msgs::Pose pose;
+    for(size_t i = 0; i < kept_.size(); i++)
+    {
+        pose.position.x = kept_[i].x;
+        pose.position.y = kept_[i].y;
+        pose.position.z = 0.0;
+        legs.poses.push_back(pose);
+    }
+
+    return kept_.size();
+}
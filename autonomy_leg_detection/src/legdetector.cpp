@@ -0,0 +1,373 @@
+#include "legdetector.h"
+#include <angles/angles.h>
+#include <assert.h>
+#include <cstdlib>
+
+#define M2MM_RATIO 1000.
+
+CLegDetector::CLegDetector():
+    background_enable_(false),
+    stationary_linear_(0.01),
+    stationary_angular_(0.01),
+    stationary_(false),
+    track_radius_(500.0)
+{
+    StageTimes_t zero = {0.0, 0.0, 0.0, 0.0, 0.0};
+    stage_times_ = zero;
+}
+
+void CLegDetector::init(const ros::NodeHandle& private_n)
+{
+    double arc_min_aperture, arc_max_aperture, arc_std_max, segmentation_threshold;
+    double line_min_distance, line_error_threshold, max_leg_diameter, min_leg_diameter;
+    double leg_clean_ticks, person_clean_ticks, leg_update_radius, person_radius;
+    private_n.param("laserFeature/arc_min_aperture", arc_min_aperture, angles::from_degrees(10.0));
+    ROS_INFO("laserFeature/arc_min_aperture is set to %.2lf",arc_min_aperture);
+
+    private_n.param("laserFeature/arc_max_aperture", arc_max_aperture, angles::from_degrees(20.0));
+    ROS_INFO("laserFeature/arc_max_aperture is set to %.2lf",arc_max_aperture);
+
+    private_n.param("laserFeature/arc_std_max", arc_std_max,0.2);
+    ROS_INFO("laserFeature/arc_std_max is set to %.2lf", arc_std_max);
+
+    private_n.param("laserFeature/segmentation_threshold", segmentation_threshold,500.0);
+    ROS_INFO("laserFeature/segmentation_threshold is set to %.2lf", segmentation_threshold);
+
+    private_n.param("laserFeature/line_min_distance", line_min_distance,170.0);
+    ROS_INFO("laserFeature/line_min_distance is set to %.2lf",line_min_distance);
+
+    private_n.param("laserFeature/line_error_threshold", line_error_threshold,5.0);
+    ROS_INFO("laserFeature/line_error_threshold is set to %.2lf",line_error_threshold);
+
+    private_n.param("laserFeature/max_leg_diameter", max_leg_diameter,300.0);
+    ROS_INFO("laserFeature/max_leg_diameter is set ti %.2lf",max_leg_diameter);
+
+    private_n.param("laserFeature/min_leg_diameter", min_leg_diameter,30.0);
+    ROS_INFO("laserFeature/min_leg_diameter is set to %.2lf",min_leg_diameter);
+
+    private_n.param("featureLegTracker/leg_clean_ticks", leg_clean_ticks,5.0);
+    ROS_INFO("featureLegTracker/leg_clean_ticks is set to %.2lf",leg_clean_ticks);
+
+    private_n.param("featureLegTracker/person_clean_ticks", person_clean_ticks,5.0);
+    ROS_INFO("featureLegTracker/person_clean_ticks is set to %.2lf",person_clean_ticks);
+
+    private_n.param("featureLegTracker/leg_update_radius", leg_update_radius,100.0);
+    ROS_INFO("featureLegTracker/leg_update_radius is set to %.2lf",leg_update_radius);
+
+    private_n.param("featureLegTracker/person_radius", person_radius,300.0);
+    ROS_INFO("featureLegTracker/person_radius is set to %.2lf",person_radius);
+
+
+    laser_feature_.arc_min_aperture = arc_min_aperture;
+    laser_feature_.arc_max_aperture = arc_max_aperture;
+    laser_feature_.arc_std_max = arc_std_max;
+    laser_feature_.segmentation_threshold = segmentation_threshold;
+    laser_feature_.line_min_distance = line_min_distance;
+    laser_feature_.line_error_threshold = line_error_threshold;
+    laser_feature_.max_leg_diameter = max_leg_diameter;
+    laser_feature_.min_leg_diameter = min_leg_diameter;
+
+    leg_tracker_.leg_clean_ticks = leg_clean_ticks;
+    leg_tracker_.person_clean_ticks = person_clean_ticks;
+    leg_tracker_.leg_update_radius  =leg_update_radius;
+    leg_tracker_.person_radius = person_radius;
+
+    leg_tracker_.segmentation_threshold = laser_feature_.segmentation_threshold;
+
+    segmenter_.setParams(segmentation_threshold, arc_min_aperture, arc_max_aperture, arc_std_max);
+
+    // legs closer than this are one leg, by default one leg diameter
+    double dedup_radius;
+    private_n.param("dedup_radius", dedup_radius, max_leg_diameter / M2MM_RATIO);
+    ROS_INFO("dedup_radius is set to %.2lf", dedup_radius);
+    dedup_.setRadius(dedup_radius);
+
+    double tolerance, step;
+    int learn_scans, stable_scans;
+    private_n.param("background/enable", background_enable_, false);
+    private_n.param("background/tolerance", tolerance, 100.0);
+    private_n.param("background/median_step", step, 10.0);
+    private_n.param("background/learn_scans", learn_scans, 20);
+    private_n.param("background/stable_scans", stable_scans, 10);
+    private_n.param("background/track_radius", track_radius_, (float) 500.0);
+    private_n.param("background/stationary_linear", stationary_linear_, (float) 0.01);
+    private_n.param("background/stationary_angular", stationary_angular_, (float) 0.01);
+    background_.setParams(tolerance, step, std::max(learn_scans, 1), std::max(stable_scans, 0));
+    ROS_INFO("background/enable is set to %d", background_enable_);
+}
+
+void CLegDetector::updateOdometry(const nav_msgs::Odometry::ConstPtr& msg)
+{
+    const geometry_msgs::Twist& twist = msg->twist.twist;
+    stationary_ = (hypot(twist.linear.x, twist.linear.y) < stationary_linear_ &&
+                   fabs(twist.angular.z) < stationary_angular_);
+}
+
+bool CLegDetector::legPair(const LegSegment_t& right, const LegSegment_t& left, const float* x, const float* y)
+{
+    const float max_leg_diameter = laser_feature_.max_leg_diameter;
+    const float min_leg_diameter = laser_feature_.min_leg_diameter;
+
+    return (abs((int) right.size - (int) left.size) < 5 &&
+            hypotf(x[right.mid] - x[left.mid], y[right.mid] - y[left.mid]) < 2 * max_leg_diameter &&
+            right.width < max_leg_diameter && left.width < max_leg_diameter &&
+            right.width > min_leg_diameter && left.width > min_leg_diameter);
+}
+
+void CLegDetector::addProbableLeg(const LegSegment_t& segment, const float* x, const float* y)
+{
+    laser_feature_.AddProbableLeg(x[segment.mid], y[segment.mid],
+                                  x[segment.begin], x[segment.end],
+                                  y[segment.begin], y[segment.end],
+                                  segment.begin, segment.end);
+}
+
+bool CLegDetector::findLegPatterns(const float* x, const float* y)
+{
+
+    // CHECK IF TWO CONSECUTIVE SEGMENTS HAVE SAME NUMBER OF BEAMS
+    // AND CHECK IF THE DISTANCE BETWEEN THE MIDDLE POINTS OF TWO CANDIDATE SEGMENTS
+    //IS LESS THAN TWO*MAX LEG DIAMETER
+
+    bool find_leg_patterns = false;
+    const size_t n = segmenter_.size();
+    if(n == 0) return find_leg_patterns;
+
+    const float max_leg_diameter = laser_feature_.max_leg_diameter;
+    const float min_leg_diameter = laser_feature_.min_leg_diameter;
+    geometry_msgs::Pose tmp_leg_pose;
+    tmp_leg_pose.position.z = 0.0;
+
+    for(size_t i = 0; i < n - 1; i++)
+    {
+        const LegSegment_t& right = segmenter_[i];
+        if(right.size < 2) continue;
+
+        // TWO LEGS IN ONE SEGMENT: A PATTERN OF FALL-...-RISE-...-FALL-...-RISE
+        if(right.size > 4 && right.first_fall && right.last_rise &&
+                right.sign_changes % 2 == 1 && right.sign_changes > 1 &&
+                right.width < max_leg_diameter * 2 &&
+                right.width > min_leg_diameter * 2 &&
+                right.mid_begin < max_leg_diameter &&
+                right.mid_end < max_leg_diameter &&
+                right.mid_begin > min_leg_diameter &&
+                right.mid_end > min_leg_diameter)
+        {
+            tmp_leg_pose.position.x = x[right.mid] / M2MM_RATIO;
+            tmp_leg_pose.position.y = y[right.mid] / M2MM_RATIO;
+            pattern_legs_.poses.push_back(tmp_leg_pose);
+            find_leg_patterns = true;
+        }
+
+        // ONE LEG PER SEGMENT, THE OTHER ONE NEXT TO IT OR BEHIND ONE SEGMENT
+        size_t left_index = i + 1;
+        bool pair = legPair(right, segmenter_[left_index], x, y);
+        if(!pair && i < n - 2)
+        {
+            left_index = i + 2;
+            pair = legPair(right, segmenter_[left_index], x, y);
+        }
+
+        if(pair)
+        {
+            addProbableLeg(right, x, y);
+            addProbableLeg(segmenter_[left_index], x, y);
+            find_leg_patterns = true;
+        }
+    }
+
+    return find_leg_patterns;
+}
+
+
+bool CLegDetector::detect(const sensor_msgs::LaserScan& scan, geometry_msgs::PoseArray& publish_legs)
+{
+    publish_legs.poses.clear();
+    publish_legs.header = scan.header;
+    if(scan.ranges.empty()) return false;
+
+    ros::WallTime stage_start = ros::WallTime::now();
+    ros::WallTime stage_end;
+
+    laser_feature_.fdata.clear();
+    laser_feature_.segments.clear();
+    leg_tracker_.fdata_out.clear();
+    leg_tracker_.fdata.clear();
+
+
+    laser_feature_.max_laser_range = scan.range_max * M2MM_RATIO;
+
+    // clamp and convert with the cached beam tables; the vectors keep their capacity
+    scan_front_end_.convert(scan, M2MM_RATIO);
+    const size_t beams = scan_front_end_.size();
+    const float* x = scan_front_end_.x();
+    const float* y = scan_front_end_.y();
+
+    laser_feature_.ranges.assign(scan_front_end_.ranges(), scan_front_end_.ranges() + beams);
+    laser_feature_.point_xy.resize(beams);
+    for(size_t i = 0; i < beams; i++)
+    {
+        laser_feature_.point_xy[i].x = x[i];
+        laser_feature_.point_xy[i].y = y[i];
+    }
+
+    stage_end = ros::WallTime::now();
+    stage_times_.convert = (stage_end - stage_start).toSec();
+    stage_start = stage_end;
+
+    // SEGMENTS LASER DATA, WITH THE ARC FIT AND LEG-SHAPE FEATURES OF EVERY SEGMENT
+    // the background model only holds for the place the robot stands at
+    const bool learn_background = background_enable_ && stationary_;
+    const uint8_t* background = NULL;
+    if(learn_background)
+    {
+        // masked by the scans before this one, never around the people tracked in the last one
+        const uint8_t* near_tracks = (near_tracks_.size() == beams) ? &near_tracks_[0] : NULL;
+        background = background_.mask(scan_front_end_.ranges(), near_tracks, beams);
+    }
+    else if(background_enable_) background_.reset();
+
+    const size_t segments = segmenter_.segment(scan_front_end_.ranges(), x, y, beams,
+                                               scan.range_max * (float) M2MM_RATIO, background);
+    assert(segments < beams);
+
+    laser_feature_.segments.resize(segments);
+    for(size_t i = 0; i < segments; i++)
+    {
+        laser_feature_.segments[i].begin = segmenter_[i].begin;
+        laser_feature_.segments[i].end = segmenter_[i].end;
+    }
+
+    stage_end = ros::WallTime::now();
+    stage_times_.segment = (stage_end - stage_start).toSec();
+    stage_start = stage_end;
+
+    // CHECK FOR LEG PATTERNS (MIARN)
+    for(size_t i = 0; i < segments; i++)
+    {
+        laser_feature_.FindLeg(segmenter_[i].begin, segmenter_[i].end, segmenter_[i].arc);
+    }
+
+    // CHECK FOR LEG PATTERNS (MY ALGORITHM)
+    pattern_legs_.poses.clear();
+    findLegPatterns(x, y);
+
+    dedup_.clear();
+    for(size_t i = 0; i < pattern_legs_.poses.size(); i++)
+    {
+        dedup_.add(pattern_legs_.poses[i].position.x, pattern_legs_.poses[i].position.y, LEG_CONFIDENCE_PATTERN);
+    }
+
+    stage_end = ros::WallTime::now();
+    stage_times_.features = (stage_end - stage_start).toSec();
+    stage_start = stage_end;
+
+    // TRACK THE LEGS AND PERSONS
+
+    leg_tracker_.fdata.clear();
+    leg_tracker_.fdata.assign(laser_feature_.fdata.begin(), laser_feature_.fdata.end());
+
+    leg_tracker_.LCReset();
+    leg_tracker_.CreateIncoming();
+    leg_tracker_.LegMatchInTime();
+    leg_tracker_.LegClean();
+    leg_tracker_.LegCreate();
+    leg_tracker_.PersonUpdate();
+    leg_tracker_.PersonCreate();
+    leg_tracker_.FillFeature();
+
+    if(learn_background)
+    {
+        // this scan is background for the next ones, except where people are
+        markTracks(scan);
+        background_.learn(scan_front_end_.ranges(), &near_tracks_[0], beams);
+    }
+
+    stage_end = ros::WallTime::now();
+    stage_times_.track = (stage_end - stage_start).toSec();
+    stage_start = stage_end;
+
+    // MERGE THE PATTERN LEGS AND THE TRACKER OUTPUT, THE MOST CONFIDENT OF EACH GROUP WINS
+    for (size_t i = 0; i < leg_tracker_.fdata_out.size(); i++)
+    {
+        const int type = leg_tracker_.fdata_out.at(i).type;
+        if(type != MIARN_FEATURE_TYPE_PERSON && type != MIARN_FEATURE_TYPE_LEG) continue;
+
+        dedup_.add(leg_tracker_.fdata_out.at(i).pos[0] / M2MM_RATIO,
+                   leg_tracker_.fdata_out.at(i).pos[1] / M2MM_RATIO,
+                   type == MIARN_FEATURE_TYPE_PERSON ? LEG_CONFIDENCE_PERSON : LEG_CONFIDENCE_TRACKED_LEG);
+    }
+
+    dedup_.dedup(publish_legs);
+    stage_times_.dedup = (ros::WallTime::now() - stage_start).toSec();
+
+    return true;
+}
+
+/*
+ * Flags the beams that pass within track_radius_ of a leg or person of the
+ * tracker, so that neither the person nor what it hides is learned or masked
+ * as background.
+ */
+void CLegDetector::markTracks(const sensor_msgs::LaserScan& scan)
+{
+    const long beams = scan_front_end_.size();
+    near_tracks_.assign(beams, 0);
+
+    const float increment = fabs(scan.angle_increment);
+    if(!(increment > 0.0)) return;
+    const float direction = (scan.angle_increment > 0.0) ? 1.0 : -1.0;
+
+    for(size_t i = 0; i < leg_tracker_.fdata_out.size(); i++)
+    {
+        const int type = leg_tracker_.fdata_out.at(i).type;
+        if(type != MIARN_FEATURE_TYPE_PERSON && type != MIARN_FEATURE_TYPE_LEG) continue;
+
+        const float x = leg_tracker_.fdata_out.at(i).pos[0];
+        const float y = leg_tracker_.fdata_out.at(i).pos[1];
+        const float distance = hypot(x, y);
+        if(distance <= track_radius_)
+        {
+            // standing at the laser, it may hide anything
+            near_tracks_.assign(beams, 1);
+            return;
+        }
+
+        // beams within the angle the track covers, seen from the laser
+        const float half_width = asin(track_radius_ / distance);
+        const float offset = angles::normalize_angle_positive(direction * (atan2(y, x) - scan.angle_min));
+        const long first = std::max((long) floor((offset - half_width) / increment), 0L);
+        const long last = std::min((long) ceil((offset + half_width) / increment), beams - 1);
+        for(long b = first; b <= last; b++) near_tracks_[b] = 1;
+    }
+}
+
+void CLegDetector::legMarker(const geometry_msgs::PoseArray& legs, double scale, visualization_msgs::Marker& marker)
+{
+    geometry_msgs::Point p;
+    marker.points.clear();
+
+    marker.header.frame_id = legs.header.frame_id;
+    marker.header.stamp = ros::Time::now();
+    marker.ns = "leg_markers";
+    marker.id = 0;
+    marker.type = visualization_msgs::Marker::SPHERE_LIST;
+    marker.action = visualization_msgs::Marker::ADD;
+    marker.pose.orientation.w = 1.0;
+    marker.scale.x = scale;
+    marker.scale.y = scale;
+    marker.scale.z = 0.25;
+    marker.color.r = 0.0f;
+    marker.color.g = 1.0f;
+    marker.color.b = 0.0f;
+    marker.color.a = 1.0;
+    marker.lifetime = ros::Duration(0);
+
+    for(size_t i = 0; i < legs.poses.size(); i++)
+    {
+        p.x = legs.poses.at(i).position.x;
+        p.y = legs.poses.at(i).position.y;
+        p.z = 0;
+        marker.points.push_back(p);
+    }
+}
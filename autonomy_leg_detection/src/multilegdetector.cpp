@@ -0,0 +1,133 @@
+#include "multilegdetector.h"
+#include <boost/bind.hpp>
+#include <cmath>
+
+CMultiLegDetector::CMultiLegDetector(ros::NodeHandle n, const ros::NodeHandle& private_n,
+                                     const std::vector<std::string>& topics):
+    n_(n)
+{
+    private_n.param("base_frame", base_frame_, std::string("base_footprint"));
+    private_n.param("merge_distance", merge_distance_, (float) 0.2);
+    private_n.param("merge_max_age", max_age_, (float) 0.5);
+    private_n.param("show_marker", show_marker_, true);
+    private_n.param("marker_scale", marker_scale_, 0.5);
+
+    leg_pub_ = n_.advertise<geometry_msgs::PoseArray>("legs", 10);
+    marker_pub_ = n_.advertise<visualization_msgs::Marker>("leg/marker", 1);
+    merged_.header.frame_id = base_frame_;
+
+    for(size_t i = 0; i < topics.size(); i++)
+    {
+        boost::shared_ptr<Scanner_t> scanner(new Scanner_t);
+        scanner->topic = topics[i];
+        scanner->has_extrinsic = false;
+        scanner->detector.init(private_n);
+        scanners_.push_back(scanner);
+    }
+
+    if(!scanners_.empty() && scanners_[0]->detector.backgroundEnabled())
+        odom_sub_ = n_.subscribe("husky/odom", 10, &CMultiLegDetector::odometryCallBack, this);
+
+    // subscribe once every scanner is in place, the callbacks may start right away
+    for(size_t i = 0; i < scanners_.size(); i++)
+    {
+        scanners_[i]->sub = n_.subscribe<sensor_msgs::LaserScan>(scanners_[i]->topic, 10,
+                                boost::bind(&CMultiLegDetector::laserCallBack, this, _1, i));
+        ROS_INFO("Detecting legs in %s", scanners_[i]->topic.c_str());
+    }
+}
+
+void CMultiLegDetector::odometryCallBack(const nav_msgs::Odometry::ConstPtr& msg)
+{
+    for(size_t i = 0; i < scanners_.size(); i++)
+        scanners_[i]->detector.updateOdometry(msg);
+}
+
+bool CMultiLegDetector::updateExtrinsic(Scanner_t& scanner, const std::string& frame)
+{
+    if(scanner.has_extrinsic && scanner.frame == frame) return true;
+
+    tf::StampedTransform transform;
+    try
+    {
+        tf_listener_.lookupTransform(base_frame_, frame, ros::Time(0), transform);
+    }
+    catch(tf::TransformException& ex)
+    {
+        ROS_WARN_THROTTLE(1.0, "No extrinsic for %s yet: %s", frame.c_str(), ex.what());
+        return false;
+    }
+
+    // the lasers are mounted on the robot: the extrinsic is looked up once
+    double yaw = tf::getYaw(transform.getRotation());
+    scanner.frame = frame;
+    scanner.cos_yaw = cos(yaw);
+    scanner.sin_yaw = sin(yaw);
+    scanner.x = transform.getOrigin().x();
+    scanner.y = transform.getOrigin().y();
+    scanner.has_extrinsic = true;
+    return true;
+}
+
+void CMultiLegDetector::laserCallBack(const sensor_msgs::LaserScan::ConstPtr& msg, size_t index)
+{
+    Scanner_t& scanner = *scanners_[index];
+
+    // only this callback touches the detector of the scanner
+    if(!updateExtrinsic(scanner, msg->header.frame_id)) return;
+    if(!scanner.detector.detect(*msg, scanner.detected)) return;
+
+    for(size_t i = 0; i < scanner.detected.poses.size(); i++)
+    {
+        geometry_msgs::Point& p = scanner.detected.poses[i].position;
+        float x = p.x, y = p.y;
+        p.x = scanner.cos_yaw * x - scanner.sin_yaw * y + scanner.x;
+        p.y = scanner.sin_yaw * x + scanner.cos_yaw * y + scanner.y;
+    }
+
+    boost::mutex::scoped_lock lock(mutex_);
+    scanner.legs.poses.swap(scanner.detected.poses);
+    scanner.stamp = msg->header.stamp;
+    publishMerged();
+}
+
+void CMultiLegDetector::publishMerged()
+{
+    ros::Time newest;
+    for(size_t s = 0; s < scanners_.size(); s++)
+        if(scanners_[s]->stamp > newest) newest = scanners_[s]->stamp;
+
+    const float d2 = merge_distance_ * merge_distance_;
+    merged_.poses.clear();
+
+    for(size_t s = 0; s < scanners_.size(); s++)
+    {
+        const Scanner_t& scanner = *scanners_[s];
+        if(scanner.stamp.isZero() || (newest - scanner.stamp).toSec() > max_age_) continue;
+
+        // only legs of the other scanners, two close legs of one scan are two legs
+        const size_t others = merged_.poses.size();
+        for(size_t i = 0; i < scanner.legs.poses.size(); i++)
+        {
+            const geometry_msgs::Point& p = scanner.legs.poses[i].position;
+            bool new_leg = true;
+            for(size_t j = 0; j < others && new_leg; j++)
+            {
+                float dx = p.x - merged_.poses[j].position.x;
+                float dy = p.y - merged_.poses[j].position.y;
+                new_leg = (dx * dx + dy * dy >= d2);
+            }
+            if(new_leg) merged_.poses.push_back(scanner.legs.poses[i]);
+        }
+    }
+
+    merged_.header.stamp = newest;
+    leg_pub_.publish(merged_);
+
+    if(show_marker_ && marker_pub_.getNumSubscribers() > 0)
+    {
+        visualization_msgs::Marker marker;
+        CLegDetector::legMarker(merged_, marker_scale_, marker);
+        marker_pub_.publish(marker);
+    }
+}
@@ -0,0 +1,122 @@
+#include "scanbackground.h"
+#include <cmath>
+#include <algorithm>
+
+CScanBackground::CScanBackground():
+    tolerance_(100.0),
+    step_(10.0),
+    learn_scans_(20),
+    stable_scans_(20),
+    scans_(0),
+    masked_(0)
+{
+}
+
+void CScanBackground::setParams(float tolerance, float step, uint32_t learn_scans, uint32_t stable_scans)
+{
+    tolerance_ = tolerance;
+    step_ = step;
+    learn_scans_ = std::max(learn_scans, (uint32_t) 1);
+    stable_scans_ = stable_scans;
+    reset();
+}
+
+void CScanBackground::reset()
+{
+    scans_ = 0;
+    masked_ = 0;
+    seed_.clear();
+    seeded_.clear();
+    median_.clear();
+    stable_.clear();
+}
+
+void CScanBackground::seed(size_t n)
+{
+    median_.resize(n);
+    stable_.assign(n, 0);
+    mask_.assign(n, 0);
+    for(size_t i = 0; i < n; i++)
+    {
+        float* first = &seed_[i * learn_scans_];
+        const uint32_t k = seeded_[i];
+        if(k == 0)
+        {
+            // never seen free of people: no background until it proves stable
+            median_[i] = NAN;
+            continue;
+        }
+        std::nth_element(first, first + k / 2, first + k);
+        median_[i] = first[k / 2];
+    }
+    std::vector<float>().swap(seed_);
+    std::vector<uint32_t>().swap(seeded_);
+}
+
+void CScanBackground::learn(const float* ranges, const uint8_t* exclude, size_t n)
+{
+    if(scans_ < learn_scans_)
+    {
+        // the first scans only collect ranges, the median starts from all of them
+        if(seeded_.size() != n)
+        {
+            seed_.resize(n * learn_scans_);
+            seeded_.assign(n, 0);
+            median_.clear();
+            scans_ = 0;
+        }
+        for(size_t i = 0; i < n; i++)
+        {
+            if(exclude && exclude[i]) continue;
+            seed_[i * learn_scans_ + seeded_[i]++] = ranges[i];
+        }
+        if(++scans_ == learn_scans_) seed(n);
+        return;
+    }
+
+    if(median_.size() != n)
+    {
+        // the scan layout changed, start over
+        reset();
+        learn(ranges, exclude, n);
+        return;
+    }
+
+    const float step = step_;
+    const float tolerance = tolerance_;
+    float* __restrict m = &median_[0];
+    uint32_t* __restrict s = &stable_[0];
+    for(size_t i = 0; i < n; i++)
+    {
+        if(exclude && exclude[i]) continue;
+
+        // a beam without a median takes the first range it sees, the stable count guards it
+        if(std::isnan(m[i])) m[i] = ranges[i];
+
+        const bool match = (fabsf(ranges[i] - m[i]) <= tolerance);
+        s[i] = match ? std::min(s[i] + 1, stable_scans_) : 0;
+
+        // +step above the median, -step below it
+        m[i] += step * ((ranges[i] > m[i]) - (ranges[i] < m[i]));
+    }
+    scans_++;
+}
+
+const uint8_t* CScanBackground::mask(const float* ranges, const uint8_t* exclude, size_t n)
+{
+    masked_ = 0;
+    if(!ready() || median_.size() != n) return NULL;
+
+    const float tolerance = tolerance_;
+    const uint32_t stable_scans = stable_scans_;
+    const float* __restrict m = &median_[0];
+    const uint32_t* __restrict s = &stable_[0];
+    uint8_t* __restrict out = &mask_[0];
+    for(size_t i = 0; i < n; i++)
+    {
+        out[i] = (s[i] >= stable_scans && fabsf(ranges[i] - m[i]) <= tolerance);
+        if(exclude) out[i] &= !exclude[i];
+        masked_ += out[i];
+    }
+    return out;
+}
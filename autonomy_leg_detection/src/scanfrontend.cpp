@@ -0,0 +1,75 @@
+#include "scanfrontend.h"
+#include <cmath>
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+CScanFrontEnd::CScanFrontEnd():
+    angle_min_(0.0),
+    angle_increment_(0.0),
+    beams_(0)
+{
+}
+
+void CScanFrontEnd::updateTables(const sensor_msgs::LaserScan& scan)
+{
+    angle_min_ = scan.angle_min;
+    angle_increment_ = scan.angle_increment;
+    beams_ = scan.ranges.size();
+
+    // padded to whole SSE vectors
+    const size_t padded = (beams_ + 3) & ~size_t(3);
+    cos_.assign(padded, 0.0);
+    sin_.assign(padded, 0.0);
+    ranges_.assign(padded, 0.0);
+    x_.assign(padded, 0.0);
+    y_.assign(padded, 0.0);
+
+    for(size_t i = 0; i < beams_; i++)
+    {
+        double b = angle_min_ + i * angle_increment_;
+        cos_[i] = cos(b);
+        sin_[i] = sin(b);
+    }
+}
+
+void CScanFrontEnd::convert(const sensor_msgs::LaserScan& scan, float scale)
+{
+    if(scan.ranges.size() != beams_ || scan.angle_min != angle_min_ ||
+            scan.angle_increment != angle_increment_)
+        updateTables(scan);
+
+    if(beams_ == 0) return;
+
+    const float lo = scan.range_min * scale;
+    const float hi = scan.range_max * scale;
+    const float* src = &scan.ranges[0];
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128 vscale = _mm_set1_ps(scale);
+    const __m128 vlo = _mm_set1_ps(lo);
+    const __m128 vhi = _mm_set1_ps(hi);
+
+    for(; i + 4 <= beams_; i += 4)
+    {
+        // min(NaN, hi) is hi: invalid beams end up at the maximum range, no return
+        __m128 r = _mm_mul_ps(_mm_loadu_ps(src + i), vscale);
+        r = _mm_max_ps(_mm_min_ps(r, vhi), vlo);
+        _mm_storeu_ps(&ranges_[i], r);
+        _mm_storeu_ps(&x_[i], _mm_mul_ps(r, _mm_loadu_ps(&cos_[i])));
+        _mm_storeu_ps(&y_[i], _mm_mul_ps(r, _mm_loadu_ps(&sin_[i])));
+    }
+#endif
+
+    for(; i < beams_; i++)
+    {
+        float r = src[i] * scale;
+        r = (r == r) ? std::min(std::max(r, lo), hi) : hi;
+        ranges_[i] = r;
+        x_[i] = r * cos_[i];
+        y_[i] = r * sin_[i];
+    }
+}
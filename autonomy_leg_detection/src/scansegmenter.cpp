@@ -0,0 +1,147 @@
+#include "scansegmenter.h"
+#include <cmath>
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+CScanSegmenter::CScanSegmenter():
+    jump_threshold_(500.0),
+    arc_min_aperture_(M_PI / 2.0),
+    arc_max_aperture_(3.0 * M_PI / 4.0),
+    arc_std_max_(0.2),
+    count_(0)
+{
+}
+
+void CScanSegmenter::setParams(float jump_threshold, float arc_min_aperture, float arc_max_aperture, float arc_std_max)
+{
+    jump_threshold_ = jump_threshold;
+    arc_min_aperture_ = arc_min_aperture;
+    arc_max_aperture_ = arc_max_aperture;
+    arc_std_max_ = arc_std_max;
+}
+
+/*
+ * Inscribed angle variance: every inner point of an arc sees the two end
+ * points under the same angle, obtuse for the front of a leg.
+ */
+void CScanSegmenter::fitArc(LegSegment_t& s, const float* x, const float* y)
+{
+    s.arc_mean = s.arc_std = 0.0;
+    s.arc = false;
+    if(s.size < 3) return;
+
+    float sum = 0.0, sum2 = 0.0;
+    for(uint32_t i = s.begin + 1; i < s.end; i++)
+    {
+        float ax = x[s.begin] - x[i], ay = y[s.begin] - y[i];
+        float bx = x[s.end] - x[i], by = y[s.end] - y[i];
+        float angle = atan2f(fabsf(ax * by - ay * bx), ax * bx + ay * by);
+        sum += angle;
+        sum2 += angle * angle;
+    }
+
+    const float n = s.size - 2;
+    s.arc_mean = sum / n;
+    s.arc_std = sqrtf(std::max(0.0f, sum2 / n - s.arc_mean * s.arc_mean));
+    s.arc = (s.arc_mean > arc_min_aperture_ && s.arc_mean < arc_max_aperture_ && s.arc_std < arc_std_max_);
+}
+
+void CScanSegmenter::addSegment(uint32_t begin, uint32_t end, const float* x, const float* y)
+{
+    if(count_ == segments_.size()) segments_.resize(std::max<size_t>(64, 2 * segments_.size()));
+    LegSegment_t& s = segments_[count_++];
+
+    s.begin = begin;
+    s.end = end;
+    s.mid = (begin + end) / 2;
+    s.size = end - begin + 1;
+    s.width = hypotf(x[end] - x[begin], y[end] - y[begin]);
+    s.mid_begin = hypotf(x[s.mid] - x[begin], y[s.mid] - y[begin]);
+    s.mid_end = hypotf(x[end] - x[s.mid], y[end] - y[s.mid]);
+
+    // slopes begin .. end-1, sign changes between slope k and k+1 for k < end-1
+    s.sign_changes = (s.size > 2) ? changes_[end - 1] - changes_[begin] : 0;
+    s.first_fall = (s.size > 1) && !rise_[begin];
+    s.last_rise = (s.size > 1) && rise_[end - 1];
+
+    fitArc(s, x, y);
+}
+
+size_t CScanSegmenter::segment(const float* ranges, const float* x, const float* y, size_t n, float max_range,
+                               const uint8_t* mask)
+{
+    count_ = 0;
+    if(n == 0) return 0;
+
+    breaks_.resize(n);
+    rise_.resize(n);
+    changes_.resize(n);
+    breaks_[n - 1] = 1;
+    rise_[n - 1] = 0;
+
+    const float threshold2 = jump_threshold_ * jump_threshold_;
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128 vthreshold2 = _mm_set1_ps(threshold2);
+    const __m128 vmax = _mm_set1_ps(max_range);
+
+    // beams i .. i+4 are read, four pairs at a time
+    for(; i + 4 < n; i += 4)
+    {
+        __m128 x0 = _mm_loadu_ps(x + i), x1 = _mm_loadu_ps(x + i + 1);
+        __m128 y0 = _mm_loadu_ps(y + i), y1 = _mm_loadu_ps(y + i + 1);
+        __m128 r0 = _mm_loadu_ps(ranges + i), r1 = _mm_loadu_ps(ranges + i + 1);
+
+        __m128 dx = _mm_sub_ps(x1, x0), dy = _mm_sub_ps(y1, y0);
+        __m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        __m128 jump = _mm_or_ps(_mm_cmpgt_ps(d2, vthreshold2),
+                                _mm_or_ps(_mm_cmpge_ps(r0, vmax), _mm_cmpge_ps(r1, vmax)));
+
+        int jumps = _mm_movemask_ps(jump);
+        int rises = _mm_movemask_ps(_mm_cmpgt_ps(r1, r0));
+        for(int k = 0; k < 4; k++)
+        {
+            breaks_[i + k] = (jumps >> k) & 1;
+            rise_[i + k] = (rises >> k) & 1;
+        }
+    }
+#endif
+
+    for(; i + 1 < n; i++)
+    {
+        float dx = x[i + 1] - x[i], dy = y[i + 1] - y[i];
+        breaks_[i] = (dx * dx + dy * dy > threshold2 || ranges[i] >= max_range || ranges[i + 1] >= max_range);
+        rise_[i] = (ranges[i + 1] > ranges[i]);
+    }
+
+    if(mask)
+    {
+        for(i = 0; i < n; i++)
+        {
+            if(!mask[i]) continue;
+            breaks_[i] = 1;
+            if(i > 0) breaks_[i - 1] = 1;
+        }
+    }
+
+    // one walk builds the sign change count and closes the segments
+    uint32_t begin = 0;
+    changes_[0] = 0;
+    for(uint32_t k = 0; k < n; k++)
+    {
+        if(k + 1 < n) changes_[k + 1] = changes_[k] + (k + 2 < n && rise_[k] != rise_[k + 1]);
+
+        if(breaks_[k])
+        {
+            // a beam without return or a masked one is not a segment
+            if(ranges[begin] < max_range && !(mask && mask[begin])) addSegment(begin, k, x, y);
+            begin = k + 1;
+        }
+    }
+
+    return count_;
+}
@@ -0,0 +1,212 @@
+#include "scansimulator.h"
+#include <ros/ros.h>
+#include <cmath>
+#include <boost/random/uniform_real.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/variate_generator.hpp>
+
+#define LEG_RADIUS 0.06         // [m]
+#define LEG_LATERAL 0.1         // [m] from the centre of the person
+#define LEG_SWING 0.2           // [m] along the heading
+#define STRIDE 1.2              // [m] per gait cycle
+
+CScanSimulator::CScanSimulator():
+    params_(defaultParams()),
+    seq_(0)
+{
+}
+
+CScanSimulator::Params_t CScanSimulator::defaultParams()
+{
+    Params_t p;
+    p.beams = 720;
+    p.fov = 1.5 * M_PI;
+    p.range_max = 20.0;
+    p.rate = 40.0;
+    p.noise = 0.01;
+    p.room_x = 6.0;
+    p.room_y = 4.0;
+    p.people = 3;
+    p.clutter = 10;
+    p.min_hits = 3;
+    return p;
+}
+
+float CScanSimulator::uniform(float a, float b)
+{
+    boost::variate_generator<boost::mt19937&, boost::uniform_real<float> > gen(rng_, boost::uniform_real<float>(a, b));
+    return gen();
+}
+
+void CScanSimulator::reset(const Params_t& params, unsigned int seed)
+{
+    ROS_ASSERT(params.beams > 1);
+    params_ = params;
+    rng_.seed(seed);
+    seq_ = 0;
+
+    const float rx = params_.room_x;
+    const float ry = params_.room_y;
+
+    /* The room and a partition wall */
+    Segment_t walls[] = {
+        {-rx, -ry,  rx, -ry},
+        { rx, -ry,  rx,  ry},
+        { rx,  ry, -rx,  ry},
+        {-rx,  ry, -rx, -ry},
+        {0.3f * rx, -ry, 0.3f * rx, -0.3f * ry}
+    };
+    walls_.assign(walls, walls + sizeof(walls) / sizeof(walls[0]));
+
+    /* Thin poles to bins, none right next to the laser */
+    clutter_.clear();
+    while(clutter_.size() < params_.clutter)
+    {
+        Circle_t c;
+        c.x = uniform(-rx + 0.3, rx - 0.3);
+        c.y = uniform(-ry + 0.3, ry - 0.3);
+        c.r = uniform(0.02, 0.25);
+        if(hypotf(c.x, c.y) > 1.0) clutter_.push_back(c);
+    }
+
+    people_.clear();
+    while(people_.size() < params_.people)
+    {
+        Person_t p;
+        p.x = uniform(-rx + 0.5, rx - 0.5);
+        p.y = uniform(-ry + 0.5, ry - 0.5);
+        if(hypotf(p.x, p.y) < 1.0) continue;
+
+        float speed = uniform(0.5, 1.4);
+        float heading = uniform(-M_PI, M_PI);
+        p.vx = speed * cos(heading);
+        p.vy = speed * sin(heading);
+        p.phase = uniform(0.0, 2.0 * M_PI);
+        people_.push_back(p);
+    }
+}
+
+void CScanSimulator::legsOf(const Person_t& person, Circle_t& right, Circle_t& left) const
+{
+    const float speed = hypotf(person.vx, person.vy);
+    const float hx = (speed > 0.0) ? person.vx / speed : 1.0;
+    const float hy = (speed > 0.0) ? person.vy / speed : 0.0;
+    const float swing = LEG_SWING * sin(person.phase);
+
+    right.x = person.x + hy * LEG_LATERAL + hx * swing;
+    right.y = person.y - hx * LEG_LATERAL + hy * swing;
+    left.x = person.x - hy * LEG_LATERAL - hx * swing;
+    left.y = person.y + hx * LEG_LATERAL - hy * swing;
+    right.r = left.r = LEG_RADIUS;
+}
+
+void CScanSimulator::walk(Person_t& person, float dt)
+{
+    /* Wander a little, bounce off the walls and keep away from the laser */
+    const float turn = uniform(-0.5, 0.5) * dt;
+    const float vx = person.vx * cos(turn) - person.vy * sin(turn);
+    const float vy = person.vx * sin(turn) + person.vy * cos(turn);
+    person.vx = vx;
+    person.vy = vy;
+
+    if(fabs(person.x + person.vx * dt) > params_.room_x - 0.5) person.vx = -person.vx;
+    if(fabs(person.y + person.vy * dt) > params_.room_y - 0.5) person.vy = -person.vy;
+    if(hypotf(person.x, person.y) < 0.8 && person.x * person.vx + person.y * person.vy < 0.0)
+    {
+        person.vx = -person.vx;
+        person.vy = -person.vy;
+    }
+
+    person.x += person.vx * dt;
+    person.y += person.vy * dt;
+    person.phase = fmod(person.phase + 2.0 * M_PI * hypotf(person.vx, person.vy) * dt / STRIDE, 2.0 * M_PI);
+}
+
+float CScanSimulator::castRay(float c, float s, int& leg) const
+{
+    float range = params_.range_max;
+    leg = -1;
+
+    for(size_t i = 0; i < walls_.size(); i++)
+    {
+        const Segment_t& w = walls_[i];
+        const float ex = w.x1 - w.x0;
+        const float ey = w.y1 - w.y0;
+        const float den = c * ey - s * ex;
+        if(fabs(den) < 1e-9) continue;
+
+        const float t = (w.x0 * ey - w.y0 * ex) / den;
+        const float u = (w.x0 * s - w.y0 * c) / den;
+        if(t > 0.0 && t < range && u >= 0.0 && u <= 1.0) range = t;
+    }
+
+    for(size_t i = 0; i < clutter_.size() + legs_.size(); i++)
+    {
+        const bool is_leg = (i >= clutter_.size());
+        const Circle_t& o = is_leg ? legs_[i - clutter_.size()] : clutter_[i];
+        const float b = c * o.x + s * o.y;
+        const float disc = b * b - (o.x * o.x + o.y * o.y - o.r * o.r);
+        if(disc < 0.0) continue;
+
+        const float t = b - sqrt(disc);
+        if(t > 0.0 && t < range)
+        {
+            range = t;
+            leg = is_leg ? (int) (i - clutter_.size()) : -1;
+        }
+    }
+
+    return range;
+}
+
+void CScanSimulator::step(sensor_msgs::LaserScan& scan, geometry_msgs::PoseArray& truth)
+{
+    const float dt = 1.0 / params_.rate;
+
+    legs_.resize(2 * people_.size());
+    for(size_t i = 0; i < people_.size(); i++)
+    {
+        walk(people_[i], dt);
+        legsOf(people_[i], legs_[2 * i], legs_[2 * i + 1]);
+    }
+
+    scan.header.seq = seq_;
+    scan.header.stamp = ros::Time(seq_ * dt);
+    scan.header.frame_id = "laser";
+    scan.angle_min = -0.5 * params_.fov;
+    scan.angle_max = 0.5 * params_.fov;
+    scan.angle_increment = params_.fov / (params_.beams - 1);
+    scan.time_increment = 0.0;
+    scan.scan_time = dt;
+    scan.range_min = 0.02;
+    scan.range_max = params_.range_max;
+    scan.ranges.resize(params_.beams);
+    scan.intensities.clear();
+    seq_++;
+
+    boost::variate_generator<boost::mt19937&, boost::normal_distribution<float> >
+            noise(rng_, boost::normal_distribution<float>(0.0, params_.noise));
+    hits_.assign(people_.size(), 0);
+
+    for(size_t i = 0; i < params_.beams; i++)
+    {
+        const double a = scan.angle_min + i * scan.angle_increment;
+        int leg;
+        float range = castRay(cos(a), sin(a), leg);
+        if(leg >= 0) hits_[leg / 2]++;
+        if(range < params_.range_max) range += noise();
+        scan.ranges[i] = range;
+    }
+
+    truth.header = scan.header;
+    truth.poses.clear();
+    geometry_msgs::Pose pose;
+    for(size_t i = 0; i < people_.size(); i++)
+    {
+        if(hits_[i] < params_.min_hits) continue;
+        pose.position.x = people_[i].x;
+        pose.position.y = people_[i].y;
+        pose.position.z = 0.0;
+        truth.poses.push_back(pose);
+    }
+}
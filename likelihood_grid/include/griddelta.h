@@ -0,0 +1,76 @@
+#ifndef GRIDDELTA_H
+#define GRIDDELTA_H
+
+#include <vector>
+#include <string>
+#include <ros/ros.h>
+#include <nav_msgs/OccupancyGrid.h>
+#include <map_msgs/OccupancyGridUpdate.h>
+
+/*
+ * Publishes an occupancy grid as periodic keyframes on <topic> and, between
+ * keyframes, only the changed sub-rectangles on <topic>_updates
+ * (map_msgs/OccupancyGridUpdate, the same pair of topics rviz listens to).
+ *
+ * The grid is split into square tiles. A tile is dirty when any of its cells
+ * differs from what the client already has by more than the deadband.
+ * Horizontal runs of dirty tiles are sent as one update each.
+ */
+
+class CGridDeltaPublisher
+{
+private:
+    ros::Publisher grid_pub_;
+    ros::Publisher update_pub_;
+
+    nav_msgs::OccupancyGrid last_sent_;     // the grid as the client currently sees it
+    map_msgs::OccupancyGridUpdate update_;
+    std::vector<bool> dirty_tiles_;
+
+    bool enabled_;
+    uint32_t cycle_;
+    int keyframe_period_;
+    uint32_t tile_size_;
+    int deadband_;
+    float max_update_ratio_;                // above this fraction of dirty cells send a keyframe
+
+    bool sameGeometry(const nav_msgs::OccupancyGrid& grid);
+    void publishKeyframe(const nav_msgs::OccupancyGrid& grid);
+    size_t markDirtyTiles(const nav_msgs::OccupancyGrid& grid, uint32_t tiles_x, uint32_t tiles_y);
+    void publishRect(const nav_msgs::OccupancyGrid& grid,
+                     uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
+public:
+    CGridDeltaPublisher();
+
+    void init(ros::NodeHandle& n, const std::string& topic, bool enabled,
+              int keyframe_period = 10, int tile_size = 8, int deadband = 1,
+              float max_update_ratio = 0.5);
+
+    void publish(const nav_msgs::OccupancyGrid& grid);
+    uint32_t getNumSubscribers() const;
+};
+
+/*
+ * Client side: rebuilds the full grid from the keyframe topic and the
+ * incremental update topic published by CGridDeltaPublisher.
+ */
+
+class CGridReassembler
+{
+private:
+    nav_msgs::OccupancyGrid grid_;
+    ros::Time keyframe_stamp_;     // updates older than the keyframe are stale
+    bool has_keyframe_;
+
+public:
+    CGridReassembler();
+
+    void gridCallBack(const nav_msgs::OccupancyGridConstPtr& msg);
+    void updateCallBack(const map_msgs::OccupancyGridUpdateConstPtr& msg);
+
+    bool hasGrid() const {return has_keyframe_;}
+    const nav_msgs::OccupancyGrid& grid() const {return grid_;}
+};
+
+#endif // GRIDDELTA_H
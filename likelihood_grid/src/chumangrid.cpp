@@ -29,7 +29,19 @@ CHumanGrid::CHumanGrid(ros::NodeHandle n, float lw, float sw, float tw, int _pro
 
 void CHumanGrid::init()
 {
-    human_grid_pub_ = n_.advertise<nav_msgs::OccupancyGrid>("human/grid", 10);
+    bool delta_updates;
+    int keyframe_period, tile_size;
+    ros::param::param("~/delta_updates_enable", delta_updates, false);
+    ros::param::param("~/delta_keyframe_period", keyframe_period, 10);
+    ros::param::param("~/delta_tile_size", tile_size, 8);
+    // [s] a source counts half after this long
+    ros::param::param("~/fusion_staleness_half_life", fusion_half_life_, (float) 1.0);
+    ros::param::param("~/fusion_max_age", fusion_max_age_, (float) 3.0);
+    ros::param::param("~/mixture_fusion_enable", mixture_fusion_, false);
+    ros::param::param("~/mixture_peak_min_distance", peak_min_distance_, (float) 0.5);
+    ros::param::param("~/mixture_ray_range", ray_range_, (float) 2.0);
+    human_grid_pub_.init(n_, "human/grid", delta_updates, keyframe_period, tile_size);
+
     highest_point_pub_ = n_.advertise<geometry_msgs::PointStamped>("human/maximum_probability", 10) ;
     local_maxima_pub_ = n_.advertise<geometry_msgs::PoseArray>("human/local_maxima",10);
     proj_pub_ = n_.advertise<geometry_msgs::PoseArray>("human/projection",10);
@@ -37,14 +49,16 @@ void CHumanGrid::init()
 
     initGrid();
     calculateProbabilityThreshold();
-    leg_prob_.poses.resize(1600); //TODO: FIX THIS
-    sound_prob_.poses.resize(1600);
-    torso_prob_.poses.resize(1600);
+    leg_prob_.prob.resize(NodeGridSpec::cells, 0.0);
+    sound_prob_.prob.resize(NodeGridSpec::cells, 0.0);
+    torso_prob_.prob.resize(NodeGridSpec::cells, 0.0);
+    leg_prob_.received = sound_prob_.received = torso_prob_.received = false;
+    leg_mixture_.received = sound_mixture_.received = torso_mixture_.received = false;
     occupancy_grid_.data.resize(grid_->grid_size, 0.0);
-    occupancy_grid_.info.height = occupancy_grid_.info.width = 40;
-    occupancy_grid_.info.resolution = 0.5;
-    occupancy_grid_.info.origin.position.x = (float) 40 * 0.5 / -2.0;
-    occupancy_grid_.info.origin.position.y = (float) 40 * 0.5 / -2.0;
+    occupancy_grid_.info.height = occupancy_grid_.info.width = NodeGridSpec::size;
+    occupancy_grid_.info.resolution = NodeGridSpec::resolution();
+    occupancy_grid_.info.origin.position.x = -NodeGridSpec::halfExtent();
+    occupancy_grid_.info.origin.position.y = -NodeGridSpec::halfExtent();
     occupancy_grid_.header.frame_id = "base_footprint";
     hp_.header.frame_id = "base_footprint";
     tracked_hp_.point.z = hp_.point.z = 0.0;
@@ -69,7 +83,7 @@ void CHumanGrid::initGrid()
 
     try
     {
-        grid_ = new CGrid(40, sfov, 0.5, cp, 0.9, 0.1, probability_projection_step);
+        grid_ = new CGrid(NodeGridSpec::size, sfov, NodeGridSpec::resolution(), cp, 0.9, 0.1, probability_projection_step);
     }
     catch (std::bad_alloc& ba)
     {
@@ -86,43 +100,67 @@ void CHumanGrid::initGrid()
     grid_->local_maxima_poses.header.frame_id = "base_footprint";
 }
 
-void CHumanGrid::legCallBack(const geometry_msgs::PoseArrayConstPtr &msg)
+bool CHumanGrid::bufferProbabilities(const geometry_msgs::PoseArrayConstPtr& msg, StampedGrid_t& grid)
 {
-    leg_prob_.poses.clear();
-    leg_prob_.poses = msg->poses;
+    if(msg->poses.size() != grid_->grid_size)
+    {
+        ROS_WARN("Received a probability grid of %lu cells, expected %u.", msg->poses.size(), grid_->grid_size);
+        return false;
+    }
 
-    leg_max_ = 0.0;
-    for(size_t i = 0; i < leg_prob_.poses.size(); i++)
+    grid.max = 0.0;
+    for(size_t i = 0; i < msg->poses.size(); i++)
     {
-        leg_max_ = (leg_max_ > leg_prob_.poses.at(i).position.z)
-                ? leg_max_ : leg_prob_.poses.at(i).position.z;
+        grid.prob[i] = msg->poses[i].position.z;
+        grid.max = std::max(grid.max, grid.prob[i]);
     }
+    grid.stamp = (msg->header.stamp.isZero()) ? ros::Time::now() : msg->header.stamp;
+    grid.received = true;
+    return true;
 }
 
-void CHumanGrid::soundCallBack(const geometry_msgs::PoseArrayConstPtr& msg)
+/*
+ * Every fresh grid triggers the fusion at its own stamp: the other sources
+ * take part with a confidence that decays with how much older they are.
+ */
+void CHumanGrid::legCallBack(const geometry_msgs::PoseArrayConstPtr &msg)
 {
-    sound_prob_.poses.clear();
-    sound_prob_.poses = msg->poses;
+    if(bufferProbabilities(msg, leg_prob_)) integrateProbabilities(leg_prob_.stamp);
+}
 
-    sound_max_ = 0.0;
-    for(size_t i = 0; i < sound_prob_.poses.size(); i++)
-    {
-        sound_max_ = (sound_max_ > sound_prob_.poses.at(i).position.z)
-                ? sound_max_ : sound_prob_.poses.at(i).position.z;
-    }
+void CHumanGrid::soundCallBack(const geometry_msgs::PoseArrayConstPtr& msg)
+{
+    if(bufferProbabilities(msg, sound_prob_)) integrateProbabilities(sound_prob_.stamp);
 }
 
 void CHumanGrid::torsoCallBack(const geometry_msgs::PoseArrayConstPtr &msg)
 {
-    torso_prob_.poses.clear();
-    torso_prob_.poses = msg->poses;
+    if(bufferProbabilities(msg, torso_prob_)) integrateProbabilities(torso_prob_.stamp);
+}
+
+bool CHumanGrid::bufferMixture(const likelihood_grid::GaussianMixtureStampedConstPtr& msg, StampedMixture_t& mixture)
+{
+    if(!mixture.mixture.fromMessage(msg->mixture)) return false;
 
-    torso_max_ = 0.0;
-    for(size_t i = 0; i < torso_prob_.poses.size(); i++)
-    {
-        torso_max_ = (torso_max_ > torso_prob_.poses.at(i).position.z)
-                ? torso_max_ : torso_prob_.poses.at(i).position.z;
-    }
+    // aged from when the sensor grid computed it, not from when it got here
+    mixture.stamp = (msg->header.stamp.isZero()) ? ros::Time::now() : msg->header.stamp;
+    mixture.received = true;
+    return true;
+}
+
+void CHumanGrid::legMixtureCallBack(const likelihood_grid::GaussianMixtureStampedConstPtr& msg)
+{
+    if(bufferMixture(msg, leg_mixture_)) integrateMixtures(leg_mixture_.stamp);
+}
+
+void CHumanGrid::soundMixtureCallBack(const likelihood_grid::GaussianMixtureStampedConstPtr& msg)
+{
+    if(bufferMixture(msg, sound_mixture_)) integrateMixtures(sound_mixture_.stamp);
+}
+
+void CHumanGrid::torsoMixtureCallBack(const likelihood_grid::GaussianMixtureStampedConstPtr& msg)
+{
+    if(bufferMixture(msg, torso_mixture_)) integrateMixtures(torso_mixture_.stamp);
 }
 
 void CHumanGrid::encoderCallBack(const nav_msgs::OdometryConstPtr& msg)
@@ -205,34 +243,47 @@ void CHumanGrid::publishProjection()
 }
 
 
-void CHumanGrid::integrateProbabilities()
+/*
+ * The weight a source keeps after the staleness decay, 0 when it is missing
+ * or too old. The rest of its configured weight is fused as absent (zero
+ * probability), so the fused values stay on the scale of the sum of all
+ * three weights the cue thresholds are computed from.
+ */
+float CHumanGrid::freshWeight(const ros::Time& stamp, bool received, float weight, const ros::Time& target_time) const
 {
-    ros::Time now = ros::Time::now();
+    if(!received) return 0.0;
 
-//    float maxw = std::max(std::max(leg_max_, sound_max_), torso_max_);
-//    lw_  = (leg_max_ > 0.0) ? (maxw / leg_max_) : 1.0;
-//    sw_ = (sound_max_ > 0.0) ? (maxw / sound_max_) : 1.0;
-//    tw_ = (torso_max_ > 0.0) ? (maxw / torso_max_) : 1.0;
+    // a source stamped after the target time is as fresh as it gets
+    float age = std::max(0.0, (target_time - stamp).toSec());
+    if(age > fusion_max_age_) return 0.0;
 
-    lw_ = sw_ = tw_ = 1.0; //TODO: REMOVE THESE PARAMS
+    if(fusion_half_life_ > 0.0 && age > 0.0) weight *= pow(0.5, age / fusion_half_life_);
+    return weight;
+}
 
-    float num = 0.0;
-    float denum = (lw_ * leg_weight_) + (sw_ * sound_weight_) + (tw_ * torso_weight_); //
+void CHumanGrid::addToFusion(const StampedGrid_t& grid, float weight, const ros::Time& target_time)
+{
+    float fresh = freshWeight(grid.stamp, grid.received, weight, target_time);
+    fusion_.add(grid.prob, fresh);
+    fusion_.addAbsent(weight - fresh);
+}
 
-    std::vector<float> temp;
-    temp.resize(prob_.poses.size());
+void CHumanGrid::integrateProbabilities(const ros::Time& target_time)
+{
+    ros::Time now = ros::Time::now();
 
-    float max = -1000;
+    fusion_.clear();
+    addToFusion(leg_prob_, leg_weight_, target_time);
+    addToFusion(sound_prob_, sound_weight_, target_time);
+    addToFusion(torso_prob_, torso_weight_, target_time);
+    if(!fusion_.fuse(grid_->posterior)) return;
 
+    std::vector<float>& temp = grid_->posterior;
+    float max = -1000;
 
     for(size_t i = 0; i < grid_->grid_size; i++)
     {
-        num =   lw_ * leg_weight_ * leg_prob_.poses.at(i).position.z +
-                sw_ * sound_weight_ * sound_prob_.poses.at(i).position.z +
-                tw_ * torso_weight_ * torso_prob_.poses.at(i).position.z;
-
-        prob_.poses.at(i).position.z = num/denum;
-        temp.at(i) = grid_->posterior.at(i) = num/denum;
+        prob_.poses.at(i).position.z = temp.at(i);
         max = std::max(max, temp.at(i));
     }
 
@@ -241,7 +292,7 @@ void CHumanGrid::integrateProbabilities()
         occupancy_grid_.data.at(i) = (int) 100 * (temp.at(i)) / max;
     }
 
-    occupancy_grid_.header.stamp = now;
+    occupancy_grid_.header.stamp = target_time;
     human_grid_pub_.publish(occupancy_grid_);
 
 
@@ -259,7 +310,7 @@ void CHumanGrid::integrateProbabilities()
     transitState();
     last_time_ = now;
 
-    hp_.header.stamp = now;
+    hp_.header.stamp = target_time;
     highest_point_pub_.publish(hp_);
 
     printFusedFeatures();
@@ -268,6 +319,65 @@ void CHumanGrid::integrateProbabilities()
     publishProjection();
 }
 
+void CHumanGrid::addToMixture(const StampedMixture_t& mixture, float weight, const ros::Time& target_time)
+{
+    float fresh = freshWeight(mixture.stamp, mixture.received, weight, target_time);
+    fused_mixture_.add(mixture.mixture, fresh);
+    fused_mixture_.addAbsent(weight - fresh);
+}
+
+/*
+ * The same fusion as integrateProbabilities, done on the states of the nodes:
+ * the highest point, local maxima and projection come from the components and
+ * the human grid is only rendered when it has subscribers.
+ */
+void CHumanGrid::integrateMixtures(const ros::Time& target_time)
+{
+    ros::Time now = ros::Time::now();
+
+    fused_mixture_.clear();
+    addToMixture(leg_mixture_, leg_weight_, target_time);
+    addToMixture(sound_mixture_, sound_weight_, target_time);
+    addToMixture(torso_mixture_, torso_weight_, target_time);
+    if(fused_mixture_.sources() == 0) return;
+
+    if(human_grid_pub_.getNumSubscribers() > 0)
+    {
+        fused_mixture_.rasterise(grid_->map, grid_->posterior);
+        float max = *std::max_element(grid_->posterior.begin(), grid_->posterior.end());
+
+        for(size_t i = 0; i < grid_->grid_size; i++)
+        {
+            occupancy_grid_.data.at(i) = (max > 0.0) ? (int) 100 * grid_->posterior.at(i) / max : 0;
+        }
+
+        occupancy_grid_.header.stamp = target_time;
+        human_grid_pub_.publish(occupancy_grid_);
+    }
+
+    fused_mixture_.peaks(0.0, peak_min_distance_, ray_range_, grid_->local_maxima_poses);
+    if(!grid_->local_maxima_poses.poses.empty())
+    {
+        hp_.point = grid_->local_maxima_poses.poses.front().position;
+    }
+    else
+    {
+        hp_.point.x = hp_.point.y = -10.0;
+        hp_.point.z = 0.0;
+    }
+
+    transitState();
+    last_time_ = now;
+
+    hp_.header.stamp = target_time;
+    highest_point_pub_.publish(hp_);
+
+    printFusedFeatures();
+    publishLocalMaxima();
+    fused_mixture_.project(probability_projection_step, grid_->grid_projection);
+    publishProjection();
+}
+
 void CHumanGrid::newState()
 {
     state_time_ = ros::Time::now();
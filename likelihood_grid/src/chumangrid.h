@@ -6,29 +6,50 @@
 #include<nav_msgs/Odometry.h>
 #include<std_msgs/Float32MultiArray.h>
 #include<std_msgs/UInt8MultiArray.h>
+#include<likelihood_grid/GaussianMixtureStamped.h>
 #include"grid.h"
+#include"griddelta.h"
+#include"gridfusion.h"
+#include"gaussianmixture.h"
 
 class CHumanGrid
 {
 private:
     ros::NodeHandle n_;
-    ros::Publisher human_grid_pub_;
+    CGridDeltaPublisher human_grid_pub_;
     ros::Publisher highest_point_pub_;
     ros::Publisher local_maxima_pub_;
     ros::Publisher proj_pub_;
 
-    geometry_msgs::PoseArray leg_prob_;
-    geometry_msgs::PoseArray sound_prob_;
-    geometry_msgs::PoseArray torso_prob_;
-    geometry_msgs::PoseArray prob_;
-
-    float lw_;
-    float sw_;
-    float tw_;
+    struct StampedGrid_t{
+        std::vector<float> prob;
+        ros::Time stamp;
+        float max;
+        bool received;
+    };
 
-    float leg_max_;
-    float sound_max_;
-    float torso_max_;
+    StampedGrid_t leg_prob_;
+    StampedGrid_t sound_prob_;
+    StampedGrid_t torso_prob_;
+    geometry_msgs::PoseArray prob_;
+    CGridFusion fusion_;
+    float fusion_half_life_;        // [s]
+    float fusion_max_age_;          // [s] older sources are left out
+
+    // mixture fusion mode: the nodes send their states, no grids
+    struct StampedMixture_t{
+        CGaussianMixture mixture;
+        ros::Time stamp;
+        bool received;
+    };
+
+    bool mixture_fusion_;
+    StampedMixture_t leg_mixture_;
+    StampedMixture_t sound_mixture_;
+    StampedMixture_t torso_mixture_;
+    CGaussianMixture fused_mixture_;
+    float peak_min_distance_;       // [m] between two local maxima
+    float ray_range_;               // [m] where a bearing-only peak is put
 
     float leg_weight_;
     float sound_weight_;
@@ -62,17 +83,27 @@ private:
     void resetState();
     void calculateProbabilityThreshold();
     void publishProjection();
+    bool bufferProbabilities(const geometry_msgs::PoseArrayConstPtr& msg, StampedGrid_t& grid);
+    float freshWeight(const ros::Time& stamp, bool received, float weight, const ros::Time& target_time) const;
+    void addToFusion(const StampedGrid_t& grid, float weight, const ros::Time& target_time);
+    bool bufferMixture(const likelihood_grid::GaussianMixtureStampedConstPtr& msg, StampedMixture_t& mixture);
+    void addToMixture(const StampedMixture_t& mixture, float weight, const ros::Time& target_time);
 
 public:
 
     CHumanGrid();
     CHumanGrid(ros::NodeHandle n, int probability_projection_step);
     CHumanGrid(ros::NodeHandle n, float lw, float sw, float tw, int probability_projection_step);
-    void integrateProbabilities();
+    void integrateProbabilities(const ros::Time& target_time);
+    void integrateMixtures(const ros::Time& target_time);
+    bool mixtureFusion() const {return mixture_fusion_;}
 
     void legCallBack(const geometry_msgs::PoseArrayConstPtr& msg);
     void soundCallBack(const geometry_msgs::PoseArrayConstPtr &msg);
     void torsoCallBack(const geometry_msgs::PoseArrayConstPtr& msg);
+    void legMixtureCallBack(const likelihood_grid::GaussianMixtureStampedConstPtr& msg);
+    void soundMixtureCallBack(const likelihood_grid::GaussianMixtureStampedConstPtr& msg);
+    void torsoMixtureCallBack(const likelihood_grid::GaussianMixtureStampedConstPtr& msg);
     void weightsCallBack(const std_msgs::Float32MultiArrayConstPtr& msg);
     void encoderCallBack(const nav_msgs::OdometryConstPtr& msg);
 
@@ -2,10 +2,15 @@
 #define DEBUG false
 #define BASE_FOOTPRINT_FRAME false
 
+// Measurement variances [m^2, rad^2], for the Kalman filter and the association gate
+#define VAR_Z_RANGE 0.1
+#define VAR_Z_ANGLE angles::from_degrees(1.0)
+
 CLegGrid::CLegGrid(ros::NodeHandle _n, tf::TransformListener *_tf_listener, int _probability_projection_step):
     n_(_n),
     tf_listener_(_tf_listener),
     KFTracker_(2, 2, 2),
+    association_(ASSOCIATION_POLAR, VAR_Z_RANGE, VAR_Z_ANGLE, 9.21, 1.0), // chi2(2) 99%
     probability_projection_step(_probability_projection_step)
 {
     ROS_INFO("Constructing an instance of Leg Grid.");
@@ -15,7 +20,7 @@ CLegGrid::CLegGrid(ros::NodeHandle _n, tf::TransformListener *_tf_listener, int
 void CLegGrid::initKF()
 {
     float varU[2] = {0.1, (float) angles::from_degrees(1.0)}; // Motion (process) uncertainties
-    float varZ[2] = {0.1,(float)  angles::from_degrees(1.0)}; // Measurement uncertainties
+    float varZ[2] = {VAR_Z_RANGE, (float) VAR_Z_ANGLE}; // Measurement uncertainties
     setIdentity(KFTracker_.transitionMatrix);
 
     KFTracker_.processNoiseCov = *(cv::Mat_<float>(2, 2) << varU[0], 0.0,  0.0, varU[1]);
@@ -56,7 +61,7 @@ void CLegGrid::initGrid()
 
     try
     {
-        grid_ = new CGrid(40, sfov, 0.5, cp, 0.9, 0.1, probability_projection_step);
+        grid_ = new CGrid(NodeGridSpec::size, sfov, NodeGridSpec::resolution(), cp, 0.9, 0.1, probability_projection_step);
     } catch (std::bad_alloc& ba)
     {
         std::cerr << "In new legGrid: bad_alloc caught: " << ba.what() << '\n';
@@ -75,15 +80,23 @@ void CLegGrid::init()
 {
     last_time_ = ros::Time::now();
     last_seen_leg_ = ros::Time::now();
+    detection_stamp_ = ros::Time::now();
 
     initKF();
     initTfListener();
     initGrid();
 
+    float cluster_radius;
+    ros::param::param("~/leg/cluster_radius", cluster_radius, (float) 1.0);
+    cluster_.setRadius(cluster_radius);
+
     predicted_leg_pub_ = n_.advertise<geometry_msgs::PoseArray>("predicted_legs",10);
     grid_pub_ = n_.advertise<nav_msgs::OccupancyGrid>("leg/grid",10);
     prob_pub_ = n_.advertise<geometry_msgs::PoseArray>("leg/probability",10);
     proj_pub_ = n_.advertise<geometry_msgs::PoseArray>("leg/projection",10);
+    mixture_pub_ = n_.advertise<likelihood_grid::GaussianMixtureStamped>("leg/mixture",10);
+
+    ros::param::param("~/leg/mixture_state_enable", mixture_state_, false);
 }
 
 void CLegGrid::callbackClear()
@@ -106,12 +119,22 @@ void CLegGrid::computeObjectVelocity()
 }
 
 void CLegGrid::encoderCallBack(const nav_msgs::OdometryConstPtr &encoder_msg)
+{
+    encoder_buffer_.write(encoder_msg);
+}
+
+void CLegGrid::legsCallBack(const geometry_msgs::PoseArrayConstPtr &leg_msg)
+{
+    legs_buffer_.write(leg_msg);
+}
+
+void CLegGrid::processEncoder(const nav_msgs::OdometryConstPtr &encoder_msg)
 {
     encoder_reading_.twist = encoder_msg->twist;
     computeObjectVelocity();
 }
 
-void CLegGrid::legsCallBack(const geometry_msgs::PoseArrayConstPtr &leg_msg)
+void CLegGrid::processLegs(const geometry_msgs::PoseArrayConstPtr &leg_msg)
 
 //void CLegGrid::syncCallBack(const geometry_msgs::PoseArrayConstPtr &leg_msg,
 //                           const nav_msgs::OdometryConstPtr &encoder_msg)
@@ -141,6 +164,7 @@ void CLegGrid::legsCallBack(const geometry_msgs::PoseArrayConstPtr &leg_msg)
     }
 
     ROS_ASSERT(leg_msg->poses.size() == base_footprint_legs_.poses.size());
+    detection_stamp_ = (leg_msg->header.stamp.isZero()) ? now : leg_msg->header.stamp;
 
     if(base_footprint_legs_.poses.empty())
     {
@@ -174,39 +198,37 @@ void CLegGrid::keepLastLegs()
 }
 void CLegGrid::filterLegs()
 {
-
-    geometry_msgs::Pose new_leg, p1, p2;
-
-    /* check for close detected legs */
-    if(base_footprint_legs_.poses.size() < 2)
+    /*
+     * Legs closer than the cluster radius (transitively) belong to the same
+     * person and are replaced by their centroid. Legs further than 10 m are
+     * dropped.
+     */
+    cluster_x_.clear();
+    cluster_y_.clear();
+    for(size_t i = 0; i < base_footprint_legs_.poses.size(); i++)
     {
-        filtered_legs_.poses = base_footprint_legs_.poses;
+        const geometry_msgs::Point& p = base_footprint_legs_.poses.at(i).position;
+        if(p.x * p.x + p.y * p.y > 100.0) continue;
+        cluster_x_.push_back(p.x);
+        cluster_y_.push_back(p.y);
     }
-    else
-    {
-        if(!filtered_legs_.poses.empty()) filtered_legs_.poses.clear();
-        filtered_legs_.poses.push_back(base_footprint_legs_.poses.at(0));
-
-        for(uint8_t i = 1; i < base_footprint_legs_.poses.size(); i++)
-        {
-            p1.position = base_footprint_legs_.poses.at(i).position;
-            p2.position = filtered_legs_.poses.back().position;
 
-            if(sqrt(p1.position.x*p1.position.x + p1.position.y*p1.position.y) > 10.0) continue;
+    size_t clusters = cluster_.cluster(cluster_x_, cluster_y_, cluster_label_);
 
-            if(pointDistance(p1.position, p2.position) < 1.0)
-            {
-                filtered_legs_.poses.pop_back();
-                new_leg.position.x = (p1.position.x + p2.position.x) / 2;
-                new_leg.position.y = (p1.position.y + p2.position.y) / 2;
-                filtered_legs_.poses.push_back(new_leg);
-
-            } else
-            {
-                filtered_legs_.poses.push_back(p1);
-            }
+    filtered_legs_.poses.assign(clusters, geometry_msgs::Pose());
+    cluster_count_.assign(clusters, 0);
+    for(size_t i = 0; i < cluster_label_.size(); i++)
+    {
+        geometry_msgs::Point& c = filtered_legs_.poses.at(cluster_label_[i]).position;
+        c.x += cluster_x_[i];
+        c.y += cluster_y_[i];
+        cluster_count_.at(cluster_label_[i])++;
+    }
 
-        }
+    for(size_t k = 0; k < clusters; k++)
+    {
+        filtered_legs_.poses.at(k).position.x /= cluster_count_.at(k);
+        filtered_legs_.poses.at(k).position.y /= cluster_count_.at(k);
     }
 }
 
@@ -278,56 +300,30 @@ void CLegGrid::clearStates()
 
 void CLegGrid::addLastStates()
 {
-    std::vector<PolarPose> lstate(grid_->polar_array.past);
+    const std::vector<PolarPose>& lstate = grid_->polar_array.past;
 
     /*
-     *
-     * Go through last states. If there is a close measurement (match) for last state,
-     * pass that as its measurement i.e. we use nearest neighbour for data association
+     * Associate the last states with the new measurements (gated global nearest
+     * neighbour). A matched measurement is passed as the measurement of its state.
      * If there is no match, set a zero measurement for that state. This will increase
      * the uncertainity of that state during time. If the uncertainity is more than a
      * threshhold, we remove that state.
-     *
      */
+    association_.associate(lstate, meas_, assignment_);
 
-    /* Go through all of last tracked states*/
     for(size_t i = 0; i < lstate.size(); i++)
     {
-        std::vector<std::vector<float>::const_iterator> it(lstate.size());
-
-        /* Add last state to the current state */
         cstate_.push_back(lstate.at(i));
 
-        if(meas_.empty())
+        if(assignment_.at(i) >= 0)
         {
-            PolarPose z(-1.0, -1.0);
-            cmeas_.push_back(z); /* Only for matching number of current states with current measurements*/
+            cmeas_.push_back(meas_.at(assignment_.at(i)));
+            match_meas_.at(assignment_.at(i)) = true;
         }
-
-        /* Look for the closest current measurement to the last state*/
         else
         {
-            std::vector<float> dist;
-
-            for(size_t j = 0 ; j < meas_.size(); j++)
-            {
-                dist.push_back(lstate.at(i).distance(meas_.at(j)));
-            }
-
-            it.at(i) = (std::min_element(dist.begin(), dist.end()));
-
-            uint8_t it2 = it.at(i) - dist.begin();
-
-            if(*it.at(i) < 1.0)
-            {
-                cmeas_.push_back(meas_.at(it2));
-                match_meas_.at(it2) = true;
-            }
-            else
-            {
-                PolarPose z(-1.0, -1.0);
-                cmeas_.push_back(z);
-            }
+            PolarPose z(-1.0, -1.0);
+            cmeas_.push_back(z); /* Only for matching number of current states with current measurements*/
         }
     }
 
@@ -359,57 +355,71 @@ void CLegGrid::filterStates()
 
     ROS_ASSERT(cmeas_.size() == cstate_.size());
 
-    std::vector<PolarPose> fstate, fmeas;
-    PolarPose nstate, s1, s2, nmeas, m1, m2;
+    /*
+     * States closer than the cluster radius are merged into their centroid with
+     * zero variance. The measurement of the merged state is the centroid of the
+     * members' valid measurements, or none if no member had one.
+     */
+    if(cstate_.size() < 2) return;
+
+    cluster_x_.resize(cstate_.size());
+    cluster_y_.resize(cstate_.size());
+    for(size_t i = 0; i < cstate_.size(); i++)
+        cstate_.at(i).toCart(cluster_x_[i], cluster_y_[i]);
+
+    size_t clusters = cluster_.cluster(cluster_x_, cluster_y_, cluster_label_);
+    if(clusters == cstate_.size()) return;
 
-    /* check for close states */
-    if(cstate_.size() < 2)
+    std::vector<float> sx(clusters, 0.0), sy(clusters, 0.0), mx(clusters, 0.0), my(clusters, 0.0);
+    std::vector<int> meas_count(clusters, 0);
+    cluster_count_.assign(clusters, 0);
+
+    float x, y;
+    for(size_t i = 0; i < cstate_.size(); i++)
     {
-        fstate = cstate_;
-        fmeas = cmeas_;
+        size_t k = cluster_label_[i];
+        sx[k] += cluster_x_[i];
+        sy[k] += cluster_y_[i];
+        cluster_count_[k]++;
+
+        if(cmeas_.at(i).range > 0.0)
+        {
+            cmeas_.at(i).toCart(x, y);
+            mx[k] += x;
+            my[k] += y;
+            meas_count[k]++;
+        }
     }
-    else
+
+    std::vector<PolarPose> fstate(clusters), fmeas(clusters);
+    for(size_t k = 0; k < clusters; k++)
     {
-        if(!fstate.empty()) fstate.clear();
-        fstate.push_back(cstate_.at(0));
+        if(cluster_count_[k] == 1)
+        {
+            /* Keep single states untouched, with their variances */
+            continue;
+        }
+        fstate[k].fromCart(sx[k] / cluster_count_[k], sy[k] / cluster_count_[k]);
+        fstate[k].setZeroVar();
 
-        if(!fmeas.empty()) fmeas.clear();
-        fmeas.push_back(cmeas_.at(0));
+        if(meas_count[k] > 0)
+            fmeas[k].fromCart(mx[k] / meas_count[k], my[k] / meas_count[k]);
+        else
+            fmeas[k] = PolarPose(-1.0, -1.0);
+    }
 
-        for(uint8_t i = 1; i < cstate_.size(); i++)
+    for(size_t i = 0; i < cstate_.size(); i++)
+    {
+        size_t k = cluster_label_[i];
+        if(cluster_count_[k] == 1)
         {
-            s1 = cstate_.at(i);
-            s2 = fstate.back();
-
-            m1 = cmeas_.at(i);
-            m2 = fmeas.back();
-
-            if(s1.distance(s2) < 1.0)
-            {
-                fstate.pop_back();
-                nstate.range = (s1.range + s2.range) / 2;
-                nstate.angle = (s1.angle + s2.angle) / 2;
-                nstate.setZeroVar();
-                fstate.push_back(nstate);
-
-                fmeas.pop_back();
-                nmeas.range = (m1.range + m2.range) / 2;
-                nmeas.angle = (m1.angle + m2.angle) / 2;
-                fmeas.push_back(nstate);
-
-            } else
-            {
-                fstate.push_back(s1);
-                fmeas.push_back(m1);
-            }
+            fstate[k] = cstate_.at(i);
+            fmeas[k] = cmeas_.at(i);
         }
     }
 
-    if(!cstate_.empty()) cstate_.clear();
-    cstate_ = fstate;
-
-    if(!cmeas_.empty()) cmeas_.clear();
-    cmeas_ = fmeas;
+    cstate_.swap(fstate);
+    cmeas_.swap(fmeas);
 }
 
 void CLegGrid::makeStates()
@@ -451,7 +461,7 @@ void CLegGrid::updateKF()
     cv::Mat control = *(cv::Mat_<float>(2, 1) << 0.0, 0.0);
 
 
-    for(uint8_t i = 0; i < cstate_.size(); i++){
+    for(size_t i = 0; i < cstate_.size(); i++){
 
 
         statePast.at<float>(0,0) = cstate_.at(i).range;
@@ -520,7 +530,8 @@ void CLegGrid::publishProbability()
         max = std::max(grid_->posterior.at(i), max);
     }
 
-    prob_.header.stamp = ros::Time::now();
+    // the age of the grid is the age of the legs it was made from
+    prob_.header.stamp = detection_stamp_;
     if(prob_pub_.getNumSubscribers() > 0)
         prob_pub_.publish(prob_);
 }
@@ -549,19 +560,56 @@ void CLegGrid::publishProjection()
         proj_pub_.publish(grid_->grid_projection);
 }
 
+void CLegGrid::publishMixture()
+{
+    if(mixture_pub_.getNumSubscribers() == 0) return;
+
+    likelihood_grid::GaussianMixtureStamped msg;
+    msg.header.stamp = detection_stamp_;
+    msg.header.frame_id = "base_footprint";
+    mixture_.toMessage(msg.mixture);
+    mixture_pub_.publish(msg);
+}
+
+bool CLegGrid::gridRequested()
+{
+    return grid_pub_.getNumSubscribers() > 0 || prob_pub_.getNumSubscribers() > 0;
+}
+
 void CLegGrid::spin()
 {
+    if(encoder_buffer_.update()) processEncoder(encoder_buffer_.readBuffer());
+    if(legs_buffer_.update()) processLegs(legs_buffer_.readBuffer());
+
     if(!grid_->polar_array.predicted.empty()) grid_->polar_array.predicted.clear();
 
     ROS_INFO_COND(DEBUG,"--- spin ---");
 
     makeStates();
     updateKF();
-    grid_->updateGrid(1);
     publishPredictedLegs();
-    publishProbability();
-    publishOccupancyGrid();
-    grid_->projectGrid();
+
+    if(mixture_state_)
+    {
+        // the grid is only rendered for its subscribers
+        mixture_.setStates(grid_->polar_array.predicted);
+        grid_->polar_array.past = grid_->polar_array.predicted;
+        if(gridRequested())
+        {
+            grid_->updateGrid(1);
+            publishProbability();
+            publishOccupancyGrid();
+        }
+        mixture_.project(grid_->projection_angle_step, grid_->grid_projection);
+        publishMixture();
+    }
+    else
+    {
+        grid_->updateGrid(1);
+        publishProbability();
+        publishOccupancyGrid();
+        grid_->projectGrid();
+    }
     publishProjection();
 }
 
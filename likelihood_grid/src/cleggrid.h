@@ -5,9 +5,14 @@
 #include <tf/transform_listener.h>
 #include <sensor_msgs/LaserScan.h>
 #include "grid.h"
+#include "triplebuffer.h"
+#include "dataassociation.h"
+#include "gaussianmixture.h"
+#include "spatialcluster.h"
 #include "opencv2/highgui/highgui.hpp"
 #include "opencv2/video/tracking.hpp"
 #include <std_msgs/Float32MultiArray.h>
+#include <likelihood_grid/GaussianMixtureStamped.h>
 
 class CLegGrid
 {
@@ -20,10 +25,12 @@ private:
     ros::Publisher predicted_leg_pub_;
     ros::Publisher prob_pub_;
     ros::Publisher proj_pub_;    
+    ros::Publisher mixture_pub_;
     Velocity_t velocity_;
     ros::Duration diff_time_;
     ros::Time last_time_;
     ros::Time last_seen_leg_;
+    ros::Time detection_stamp_;     // of the legs message that last updated the grid
     CGrid* grid_;
     cv::KalmanFilter KFTracker_;
     cv::Mat KFmeasurement_;
@@ -31,6 +38,15 @@ private:
     std::vector<PolarPose> cmeas_;
     std::vector<PolarPose> meas_;
     std::vector<bool> match_meas_;
+    CDataAssociation association_;
+    CGaussianMixture mixture_;
+    bool mixture_state_;            // states kept as a mixture, the grid rendered on demand
+    std::vector<int> assignment_;
+    CSpatialCluster cluster_;
+    std::vector<float> cluster_x_;
+    std::vector<float> cluster_y_;
+    std::vector<size_t> cluster_label_;
+    std::vector<int> cluster_count_;
     nav_msgs::Odometry encoder_reading_;
     geometry_msgs::PoseArray prob_;
 //    geometry_msgs::PoseArray legs_reading_;
@@ -38,6 +54,10 @@ private:
     geometry_msgs::PoseArray base_footprint_legs_;
     int probability_projection_step;
 
+    // latest messages, handed over from the callback thread to spin()
+    CTripleBuffer<geometry_msgs::PoseArrayConstPtr> legs_buffer_;
+    CTripleBuffer<nav_msgs::OdometryConstPtr> encoder_buffer_;
+
     void init();
     void initKF();
     void initTfListener();
@@ -56,6 +76,10 @@ private:
     void filterLegs();
     void keepLastLegs();
     void publishProjection();
+    void publishMixture();
+    bool gridRequested();
+    void processLegs(const geometry_msgs::PoseArrayConstPtr& leg_msg);
+    void processEncoder(const nav_msgs::OdometryConstPtr& encoder_msg);
 
     bool transformToBase(const geometry_msgs::PoseArrayConstPtr& source,
                          geometry_msgs::PoseArray& target,
@@ -66,8 +90,6 @@ public:
     CLegGrid(ros::NodeHandle _n, tf::TransformListener* _tf_listener, int _probability_projection_step);
     ~CLegGrid();
 
-    /* TODO: use async callback */
-
 //    void syncCallBack(const geometry_msgs::PoseArrayConstPtr& leg_msg,
 //                      const nav_msgs::OdometryConstPtr& encoder_msg);
 
@@ -2,7 +2,12 @@
 
 #define DEBUG false
 
-CSoundGrid::CSoundGrid()
+// Measurement variances of the sound direction, the association gates with the same noise
+#define VAR_Z_RANGE 7.0
+#define VAR_Z_ANGLE angles::from_degrees(1.0)
+
+CSoundGrid::CSoundGrid():
+    association_(ASSOCIATION_BEARING, VAR_Z_RANGE, VAR_Z_ANGLE, 6.63, angles::from_degrees(30.0))
 {
 }
 
@@ -14,6 +19,7 @@ CSoundGrid::CSoundGrid(ros::NodeHandle _n,
                     n_(_n),
                     tf_listener_(_tf_listener),
                     KFTracker_(2, 2, 2),
+                    association_(ASSOCIATION_BEARING, VAR_Z_RANGE, VAR_Z_ANGLE, 6.63, angles::from_degrees(30.0)), // chi2(1) 99%
                     probability_projection_step(_probability_projection_step),
                     power_threshold(_power_threshold)
 {
@@ -25,6 +31,7 @@ void CSoundGrid::init()
 {
     last_heard_sound_ = ros::Time::now() ;
     last_time_ = ros::Time::now() ;
+    detection_stamp_ = ros::Time::now();
 
     initKF();
     initTfListener();
@@ -34,13 +41,16 @@ void CSoundGrid::init()
     prob_pub_ = n_.advertise<geometry_msgs::PoseArray>("sound/probability", 10);
     proj_pub_ = n_.advertise<geometry_msgs::PoseArray>("sound/projection",10);
     marker_pub_ = n_.advertise<visualization_msgs::MarkerArray>("sound/marker",10);
+    mixture_pub_ = n_.advertise<likelihood_grid::GaussianMixtureStamped>("sound/mixture",10);
+
+    ros::param::param("~/sound/mixture_state_enable", mixture_state_, false);
 }
 
 
 void CSoundGrid::initKF()
 {
     float varU[2] = {7.0, (float) angles::from_degrees(1.0)}; // Motion (process) uncertainties
-    float varZ[2] = {7.0, (float) angles::from_degrees(1.0)}; // Measurement uncertainties
+    float varZ[2] = {VAR_Z_RANGE, (float) VAR_Z_ANGLE}; // Measurement uncertainties
 
 
     KFTracker_.processNoiseCov = *(cv::Mat_<float>(2, 2) << varU[0], 0.0,  0.0, varU[1]);
@@ -84,7 +94,7 @@ void CSoundGrid::initGrid()
 
     try
     {
-        grid_ = new CGrid(40, sfov, 0.5, cp, 0.9, 0.1,probability_projection_step);
+        grid_ = new CGrid(NodeGridSpec::size, sfov, NodeGridSpec::resolution(), cp, 0.9, 0.1,probability_projection_step);
     } catch (std::bad_alloc& ba)
     {
         std::cerr << "In new SoundGrid: bad_alloc caught: " << ba.what() << '\n';
@@ -132,6 +142,12 @@ void CSoundGrid::rejectNotValidSoundSources(float p)
 
 void CSoundGrid::syncCallBack(const hark_msgs::HarkSourceConstPtr &sound_msg,
                               const nav_msgs::OdometryConstPtr &encoder_msg)
+{
+    sync_buffer_.write(std::make_pair(sound_msg, encoder_msg));
+}
+
+void CSoundGrid::processSync(const hark_msgs::HarkSourceConstPtr &sound_msg,
+                             const nav_msgs::OdometryConstPtr &encoder_msg)
 {
     ROS_INFO_COND(DEBUG,"Received encoder and sound source msgs");
     callbackClear();
@@ -147,6 +163,8 @@ void CSoundGrid::syncCallBack(const hark_msgs::HarkSourceConstPtr &sound_msg,
 
     /**** SOUND ****/
 
+    detection_stamp_ = (sound_msg->header.stamp.isZero()) ? now : sound_msg->header.stamp;
+
     ros::Duration d = now - last_heard_sound_;
 
     ss_reading_.assign(sound_msg->src.begin(), sound_msg->src.end());
@@ -293,50 +311,30 @@ void CSoundGrid::makeStates()
 
 void CSoundGrid::addLastStates()
 {
+    const std::vector<PolarPose>& lstate = grid_->polar_array.past;
 
     /*
-     * Go through last states. If there is a close measurement (match) for last state,
-     * pass that as its measurement i.e. we use nearest neighbour for data association
+     * Associate the last states with the new measurements (gated global nearest
+     * neighbour). A matched measurement is passed as the measurement of its state.
      * If there is no match, set a zero measurement for that state. This will increase
      * the uncertainity of that state during time. If the uncertainity is more than a
      * threshhold, we remove that state.
      */
-    std::vector<PolarPose> lstate(grid_->polar_array.past);
+    association_.associate(lstate, meas_, assignment_);
+
     for(size_t i = 0; i < lstate.size(); i++)
     {
-        std::vector<std::vector<float>::const_iterator> it(lstate.size());
         cstate_.push_back(lstate.at(i));
 
-        if(meas_.empty())
+        if(assignment_.at(i) >= 0)
         {
-            PolarPose z(-1.0, -1.0);
-            cmeas_.push_back(z);
+            cmeas_.push_back(meas_.at(assignment_.at(i)));
+            match_meas_.at(assignment_.at(i)) = true;
         }
-
-        /* Look for the closest current measurement to the last state*/
         else
         {
-            std::vector<float> dist;
-
-            for(size_t j = 0 ; j < meas_.size(); j++)
-            {
-                dist.push_back((lstate.at(i).angle - meas_.at(j).angle));
-            }
-
-            it.at(i) = (std::min_element(dist.begin(), dist.end()));
-
-            uint8_t it2 = it.at(i) - dist.begin();
-
-            if(*it.at(i) < angles::from_degrees(30.0))
-            {
-                cmeas_.push_back(meas_.at(it2));
-                match_meas_.at(it2) = true;
-            }
-            else
-            {
-                PolarPose z(-1.0, -1.0);
-                cmeas_.push_back(z);
-            }
+            PolarPose z(-1.0, -1.0);
+            cmeas_.push_back(z); /* Only for matching number of current states with current measurements*/
         }
     }
 
@@ -345,7 +343,6 @@ void CSoundGrid::addLastStates()
 
     ROS_ASSERT(cmeas_.size() == cstate_.size());
     ROS_ASSERT(cstate_.size() == lstate.size());
-
 }
 
 
@@ -400,7 +397,7 @@ void CSoundGrid::filterStates()
         if(!fmeas.empty()) fmeas.clear();
         fmeas.push_back(cmeas_.at(0));
 
-        for(uint8_t i = 1; i < cstate_.size(); i++)
+        for(size_t i = 1; i < cstate_.size(); i++)
         {
             s1 = cstate_.at(i);
             s2 = fstate.back();
@@ -446,6 +443,8 @@ void CSoundGrid::publishProbability()
         max = std::max(grid_->posterior.at(i), max);
     }
 
+    // a silent microphone array leaves the stamp behind, the human grid decays it
+    prob_.header.stamp = detection_stamp_;
     if(prob_pub_.getNumSubscribers() > 0)
         prob_pub_.publish(prob_);
 }
@@ -462,19 +461,56 @@ void CSoundGrid::publishProjection()
         proj_pub_.publish(grid_->grid_projection);
 }
 
+void CSoundGrid::publishMixture()
+{
+    if(mixture_pub_.getNumSubscribers() == 0) return;
+
+    likelihood_grid::GaussianMixtureStamped msg;
+    msg.header.stamp = detection_stamp_;
+    msg.header.frame_id = "base_footprint";
+    mixture_.toMessage(msg.mixture);
+    mixture_pub_.publish(msg);
+}
+
+bool CSoundGrid::gridRequested()
+{
+    return grid_pub_.getNumSubscribers() > 0 || prob_pub_.getNumSubscribers() > 0;
+}
+
 
 void CSoundGrid::spin()
 {
+    if(sync_buffer_.update())
+        processSync(sync_buffer_.readBuffer().first, sync_buffer_.readBuffer().second);
+
     if(!grid_->polar_array.predicted.empty()) grid_->polar_array.predicted.clear();
 
     ROS_INFO_COND(DEBUG,"--- spin ---");
 
     makeStates();
     updateKF();
-    grid_->updateGrid(1);
-    publishProbability();
-    publishOccupancyGrid();
-    grid_->projectGrid();
+
+    if(mixture_state_)
+    {
+        // the grid is only rendered for its subscribers
+        mixture_.setStates(grid_->polar_array.predicted);
+        grid_->polar_array.past = grid_->polar_array.predicted;
+        if(gridRequested())
+        {
+            grid_->updateGrid(1);
+            publishProbability();
+            publishOccupancyGrid();
+        }
+        mixture_.project(grid_->projection_angle_step, grid_->grid_projection);
+        publishMixture();
+    }
+    else
+    {
+        grid_->updateGrid(1);
+        publishProbability();
+        publishOccupancyGrid();
+        grid_->projectGrid();
+    }
     publishProjection();
 
 }
@@ -489,7 +525,7 @@ void CSoundGrid::updateKF()
 
     cv::Mat control = *(cv::Mat_<float>(2, 1) << 0.0, 0.0);
 
-    for(uint8_t i = 0; i < cstate_.size(); i++){
+    for(size_t i = 0; i < cstate_.size(); i++){
 
         statePast.at<float>(0,0) = cstate_.at(i).range;
         statePast.at<float>(1,0) = angles::normalize_angle(cstate_.at(i).angle);
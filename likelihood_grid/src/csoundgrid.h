@@ -6,10 +6,14 @@
 #include <tf/transform_listener.h>
 #include <sensor_msgs/LaserScan.h>
 #include "grid.h"
+#include "triplebuffer.h"
+#include "dataassociation.h"
+#include "gaussianmixture.h"
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/video/tracking.hpp>
 #include <hark_msgs/HarkSource.h>
 #include <std_msgs/Float32MultiArray.h>
+#include <likelihood_grid/GaussianMixtureStamped.h>
 
 class CSoundGrid
 {
@@ -20,11 +24,13 @@ private:
     ros::Publisher grid_pub_;
     ros::Publisher prob_pub_;
     ros::Publisher proj_pub_;
+    ros::Publisher mixture_pub_;
     ros::Publisher marker_pub_;
     Velocity_t velocity_;
     ros::Duration diff_time_;
     ros::Time last_time_;
     ros::Time last_heard_sound_;
+    ros::Time detection_stamp_;     // of the HARK message that last updated the grid
     CGrid* grid_;
     cv::KalmanFilter KFTracker_;
     cv::Mat KFmeasurement_;
@@ -35,11 +41,20 @@ private:
     PolarPose polar_ss_;
     std::vector<PolarPose> meas_;
     std::vector<bool> match_meas_;
+    CDataAssociation association_;
+    CGaussianMixture mixture_;
+    bool mixture_state_;            // states kept as a mixture, the grid rendered on demand
+    std::vector<int> assignment_;
     geometry_msgs::PoseArray prob_;
     int probability_projection_step;
     visualization_msgs::MarkerArray marker_array;
     double power_threshold;
 
+    // latest synchronized messages, handed over from the callback thread to spin()
+    CTripleBuffer<std::pair<hark_msgs::HarkSourceConstPtr, nav_msgs::OdometryConstPtr> > sync_buffer_;
+    void processSync(const hark_msgs::HarkSourceConstPtr& sound_msg,
+                     const nav_msgs::OdometryConstPtr& encoder_msg);
+
     void init();
     void initKF();
     void initGrid();
@@ -64,6 +79,8 @@ private:
     void passStates();
 
     void publishProjection();
+    void publishMixture();
+    bool gridRequested();
     void publishMarkers();
 
 
@@ -2,7 +2,12 @@
 
 #define DEBUG false
 
-CVisionGrid::CVisionGrid()
+// Measurement variances of the torso detections, shared by the Kalman filter and the association
+#define VAR_Z_RANGE 2.0
+#define VAR_Z_ANGLE angles::from_degrees(2.0)
+
+CVisionGrid::CVisionGrid():
+    association_(ASSOCIATION_BEARING, VAR_Z_RANGE, VAR_Z_ANGLE, 6.63, angles::from_degrees(10.0))
 {
 }
 
@@ -11,6 +16,7 @@ CVisionGrid::CVisionGrid(ros::NodeHandle _n, tf::TransformListener *_tf_listener
     n_(_n),
     tf_listener_(_tf_listener),
     KFTracker_(2, 2, 2),
+    association_(ASSOCIATION_BEARING, VAR_Z_RANGE, VAR_Z_ANGLE, 6.63, angles::from_degrees(10.0)), // chi2(1) 99%
     probability_projection_step(_probability_projection_step)
 {
     ROS_INFO("Constructing an instance of Vision Grid.");
@@ -20,7 +26,7 @@ CVisionGrid::CVisionGrid(ros::NodeHandle _n, tf::TransformListener *_tf_listener
 void CVisionGrid::initKF()
 {
     float varU[2] = {2.0, (float) angles::from_degrees(2.0)}; // Motion (process) uncertainties
-    float varZ[2] = {2.0,(float)  angles::from_degrees(2.0)}; // Measurement uncertainties
+    float varZ[2] = {VAR_Z_RANGE, (float) VAR_Z_ANGLE}; // Measurement uncertainties
 
 
     KFTracker_.processNoiseCov = *(cv::Mat_<float>(2, 2) << varU[0], 0.0,  0.0, varU[1]);
@@ -64,7 +70,7 @@ void CVisionGrid::initGrid()
 
     try
     {
-        grid_ = new CGrid(40, sfov, 0.5, cp, 0.9, 0.1, probability_projection_step);
+        grid_ = new CGrid(NodeGridSpec::size, sfov, NodeGridSpec::resolution(), cp, 0.9, 0.1, probability_projection_step);
     } catch (std::bad_alloc& ba)
     {
         std::cerr << "In new Vision Grid: bad_alloc caught: " << ba.what() << '\n';
@@ -84,6 +90,7 @@ void CVisionGrid::init()
 
     last_time_ = ros::Time::now();
     last_seen_torso_ = ros::Time::now();
+    detection_stamp_ = ros::Time::now();
     initKF();
     initTfListener();
     initGrid();
@@ -92,6 +99,9 @@ void CVisionGrid::init()
     prob_pub_ = n_.advertise<geometry_msgs::PoseArray>("torso/probability",10);
     proj_pub_ = n_.advertise<geometry_msgs::PoseArray>("torso/projection",10);
     marker_pub_ = n_.advertise<visualization_msgs::MarkerArray>("torso/marker",10);
+    mixture_pub_ = n_.advertise<likelihood_grid::GaussianMixtureStamped>("torso/mixture",10);
+
+    ros::param::param("~/vision/mixture_state_enable", mixture_state_, false);
 
 }
 
@@ -111,6 +121,12 @@ void CVisionGrid::computeObjectVelocity()
 
 
 void CVisionGrid::syncCallBack(const autonomy_human::raw_detectionsConstPtr &torso_msg,
+                               const nav_msgs::OdometryConstPtr &encoder_msg)
+{
+    sync_buffer_.write(std::make_pair(torso_msg, encoder_msg));
+}
+
+void CVisionGrid::processSync(const autonomy_human::raw_detectionsConstPtr &torso_msg,
                               const nav_msgs::OdometryConstPtr &encoder_msg)
 {
     ROS_INFO_COND(DEBUG,"Recieved detected torsos");
@@ -124,6 +140,7 @@ void CVisionGrid::syncCallBack(const autonomy_human::raw_detectionsConstPtr &tor
     computeObjectVelocity();
     diff_time_ = now - last_time_;
     last_time_ = now;
+    detection_stamp_ = (torso_msg->header.stamp.isZero()) ? now : torso_msg->header.stamp;
 
     /****************/
     ros::Duration d = now - last_seen_torso_;
@@ -194,64 +211,38 @@ void CVisionGrid::KeepLastTorso()
 
 void CVisionGrid::addLastStates()
 {
-    std::vector<PolarPose> lstate(grid_->polar_array.past);
+    const std::vector<PolarPose>& lstate = grid_->polar_array.past;
 
     /*
-     *
-     * Go through last states. If there is a close measurement (match) for last state,
-     * pass that as its measurement i.e. we use nearest neighbour for data association
+     * Associate the last states with the new measurements (gated global nearest
+     * neighbour). A matched measurement is passed as the measurement of its state.
      * If there is no match, set a zero measurement for that state. This will increase
      * the uncertainity of that state during time. If the uncertainity is more than a
      * threshhold, we remove that state.
-     *
      */
+    association_.associate(lstate, meas_, assignment_);
 
-    /* Go through all of last tracked states*/
     for(size_t i = 0; i < lstate.size(); i++)
     {
-        std::vector<std::vector<float>::const_iterator> it(lstate.size());
-
-        /* Add last state to the current state */
         cstate_.push_back(lstate.at(i));
 
-        if(meas_.empty())
+        if(assignment_.at(i) >= 0)
         {
-            PolarPose z(-1.0, -1.0);
-            cmeas_.push_back(z); /* Only for matching number of current states with current measurements*/
+            cmeas_.push_back(meas_.at(assignment_.at(i)));
+            match_meas_.at(assignment_.at(i)) = true;
         }
-
-        /* Look for the closest current measurement to the last state*/
         else
         {
-            std::vector<float> dist;
-
-            for(size_t j = 0 ; j < meas_.size(); j++)
-            {
-                dist.push_back((lstate.at(i).angle - meas_.at(j).angle));
-            }
-
-            it.at(i) = (std::min_element(dist.begin(), dist.end()));
-
-            uint8_t it2 = it.at(i) - dist.begin();
-
-            if(*it.at(i) < angles::from_degrees(10.0))
-            {
-                cmeas_.push_back(meas_.at(it2));
-                match_meas_.at(it2) = true;
-            }
-            else
-            {
-                PolarPose z(-1.0, -1.0);
-                cmeas_.push_back(z);
-            }
+            PolarPose z(-1.0, -1.0);
+            cmeas_.push_back(z); /* Only for matching number of current states with current measurements*/
         }
     }
 
     /* number of current measurements and current states and last states
        should be the same at this level*/
+
     ROS_ASSERT(cmeas_.size() == cstate_.size());
     ROS_ASSERT(cstate_.size() == lstate.size());
-
 }
 
 void CVisionGrid::clearStates()
@@ -301,7 +292,7 @@ void CVisionGrid::filterStates()
         if(!fmeas.empty()) fmeas.clear();
         fmeas.push_back(cmeas_.at(0));
 
-        for(uint8_t i = 1; i < cstate_.size(); i++)
+        for(size_t i = 1; i < cstate_.size(); i++)
         {
             s1 = cstate_.at(i);
             s2 = fstate.back();
@@ -374,6 +365,7 @@ void CVisionGrid::publishProbability()
         max = std::max(grid_->posterior.at(i), max);
     }
 
+    prob_.header.stamp = detection_stamp_;
     if(prob_pub_.getNumSubscribers() > 0)
         prob_pub_.publish(prob_);
 }
@@ -390,18 +382,55 @@ void CVisionGrid::publishProjection()
         proj_pub_.publish(grid_->grid_projection);
 }
 
+void CVisionGrid::publishMixture()
+{
+    if(mixture_pub_.getNumSubscribers() == 0) return;
+
+    likelihood_grid::GaussianMixtureStamped msg;
+    msg.header.stamp = detection_stamp_;
+    msg.header.frame_id = "base_footprint";
+    mixture_.toMessage(msg.mixture);
+    mixture_pub_.publish(msg);
+}
+
+bool CVisionGrid::gridRequested()
+{
+    return grid_pub_.getNumSubscribers() > 0 || prob_pub_.getNumSubscribers() > 0;
+}
+
 void CVisionGrid::spin()
 {
+    if(sync_buffer_.update())
+        processSync(sync_buffer_.readBuffer().first, sync_buffer_.readBuffer().second);
+
     if(!grid_->polar_array.predicted.empty()) grid_->polar_array.predicted.clear();
 
     ROS_INFO_COND(DEBUG,"--- spin ---");
 
     makeStates();
     updateKF();
-    grid_->updateGrid(1);
-    publishProbability();
-    publishOccupancyGrid();
-    grid_->projectGrid();
+
+    if(mixture_state_)
+    {
+        // the grid is only rendered for its subscribers
+        mixture_.setStates(grid_->polar_array.predicted);
+        grid_->polar_array.past = grid_->polar_array.predicted;
+        if(gridRequested())
+        {
+            grid_->updateGrid(1);
+            publishProbability();
+            publishOccupancyGrid();
+        }
+        mixture_.project(grid_->projection_angle_step, grid_->grid_projection);
+        publishMixture();
+    }
+    else
+    {
+        grid_->updateGrid(1);
+        publishProbability();
+        publishOccupancyGrid();
+        grid_->projectGrid();
+    }
     publishProjection();
 }
 
@@ -417,7 +446,7 @@ void CVisionGrid::updateKF()
     cv::Mat control = *(cv::Mat_<float>(2, 1) << 0.0, 0.0);
 
 
-    for(uint8_t i = 0; i < cstate_.size(); i++){
+    for(size_t i = 0; i < cstate_.size(); i++){
 
         statePast.at<float>(0,0) = cstate_.at(i).range;
         statePast.at<float>(1,0) = angles::normalize_angle(cstate_.at(i).angle);
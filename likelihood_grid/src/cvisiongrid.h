@@ -6,9 +6,13 @@
 #include <tf/transform_listener.h>
 #include <sensor_msgs/LaserScan.h>
 #include "grid.h"
+#include "triplebuffer.h"
+#include "dataassociation.h"
+#include "gaussianmixture.h"
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/video/tracking.hpp>
 #include <std_msgs/Float32MultiArray.h>
+#include <likelihood_grid/GaussianMixtureStamped.h>
 
 class CVisionGrid
 {
@@ -17,6 +21,7 @@ class CVisionGrid
     ros::Publisher grid_pub_;
     ros::Publisher prob_pub_;
     ros::Publisher proj_pub_;
+    ros::Publisher mixture_pub_;
     ros::Publisher marker_pub_;    
     Velocity_t velocity_;
     ros::Duration diff_time_;
@@ -30,11 +35,21 @@ class CVisionGrid
     std::vector<PolarPose> meas_;
     autonomy_human::raw_detections torso_reading_;
     std::vector<bool> match_meas_;
+    CDataAssociation association_;
+    CGaussianMixture mixture_;
+    bool mixture_state_;            // states kept as a mixture, the grid rendered on demand
+    std::vector<int> assignment_;
     geometry_msgs::PoseArray prob_;
     ros::Time last_seen_torso_;
+    ros::Time detection_stamp_;     // of the torso message that last updated the grid
     int probability_projection_step;
     visualization_msgs::MarkerArray marker_array;
 
+    // latest synchronized messages, handed over from the callback thread to spin()
+    CTripleBuffer<std::pair<autonomy_human::raw_detectionsConstPtr, nav_msgs::OdometryConstPtr> > sync_buffer_;
+    void processSync(const autonomy_human::raw_detectionsConstPtr& torso_msg,
+                     const nav_msgs::OdometryConstPtr& encoder_msg);
+
     void init();
     void initKF();
     void initTfListener();
@@ -52,6 +67,8 @@ class CVisionGrid
     void passStates();
     void KeepLastTorso();
     void publishProjection();
+    void publishMixture();
+    bool gridRequested();
     void publishMarkers();
 
 public:
@@ -0,0 +1,187 @@
+#include "dataassociation.h"
+#include <ros/ros.h>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+// cost of an impossible pair, larger than any gated cost
+const float CDataAssociation::NO_MATCH_COST = 1e6;
+
+CDataAssociation::CDataAssociation(AssociationMode_t mode, float noise_range, float noise_angle,
+                                   float gate, float max_distance):
+    mode_(mode),
+    noise_range_(noise_range),
+    noise_angle_(noise_angle),
+    gate_(gate),
+    max_distance_(max_distance)
+{
+    ROS_ASSERT(noise_range_ > 0.0 && noise_angle_ > 0.0 && gate_ > 0.0);
+}
+
+bool CDataAssociation::gatedCost(const PolarPose& state, const PolarPose& meas, float& cost) const
+{
+    float da = (float) angles::shortest_angular_distance(state.angle, meas.angle);
+    float d2 = (da * da) / (state.var_angle + noise_angle_);
+
+    if(mode_ == ASSOCIATION_BEARING)
+    {
+        if(fabs(da) > max_distance_) return false;
+    }
+    else
+    {
+        float dr = meas.range - state.range;
+        d2 += (dr * dr) / (state.var_range + noise_range_);
+
+        // law of cosines, same as PolarPose::distance
+        float dist2 = state.range * state.range + meas.range * meas.range -
+                2.0 * state.range * meas.range * cosf(da);
+        if(dist2 > max_distance_ * max_distance_) return false;
+    }
+
+    if(d2 > gate_) return false;
+    cost = d2;
+    return true;
+}
+
+void CDataAssociation::associate(const std::vector<PolarPose>& states,
+                                 const std::vector<PolarPose>& meas,
+                                 std::vector<int>& assignment)
+{
+    assignment.assign(states.size(), -1);
+    if(states.empty() || meas.empty()) return;
+
+    /* Find the states and measurements that take part in any candidate pair */
+    rows_.clear();
+    cols_.clear();
+    col_used_.assign(meas.size(), -1);
+
+    float c;
+    for(size_t i = 0; i < states.size(); i++)
+    {
+        bool candidate = false;
+        for(size_t j = 0; j < meas.size(); j++)
+        {
+            if(gatedCost(states[i], meas[j], c))
+            {
+                candidate = true;
+                if(col_used_[j] < 0)
+                {
+                    col_used_[j] = (int) cols_.size();
+                    cols_.push_back(j);
+                }
+            }
+        }
+        if(candidate) rows_.push_back(i);
+    }
+
+    if(rows_.empty()) return;
+
+    gated_.assign(rows_.size() * cols_.size(), NO_MATCH_COST);
+    for(size_t r = 0; r < rows_.size(); r++)
+    {
+        for(size_t k = 0; k < cols_.size(); k++)
+        {
+            if(gatedCost(states[rows_[r]], meas[cols_[k]], c))
+                gated_[r * cols_.size() + k] = c;
+        }
+    }
+
+    assign(gated_, rows_.size(), cols_.size(), row_assignment_);
+
+    for(size_t r = 0; r < rows_.size(); r++)
+    {
+        if(row_assignment_[r] >= 0)
+            assignment[rows_[r]] = (int) cols_[row_assignment_[r]];
+    }
+}
+
+void CDataAssociation::assign(const std::vector<float>& cost, size_t rows, size_t cols,
+                              std::vector<int>& assignment)
+{
+    ROS_ASSERT(cost.size() == rows * cols);
+    assignment.assign(rows, -1);
+    if(rows == 0 || cols == 0) return;
+
+    /* Square cost matrix, padded with impossible pairs */
+    size_t n = std::max(rows, cols);
+    cost_.assign(n * n, NO_MATCH_COST);
+    for(size_t r = 0; r < rows; r++)
+        std::copy(cost.begin() + r * cols, cost.begin() + (r + 1) * cols, cost_.begin() + r * n);
+
+    solve(n);
+
+    for(size_t k = 1; k <= n; k++)
+    {
+        size_t r = p_[k] - 1;
+        size_t col = k - 1;
+        if(r < rows && col < cols && cost_[r * n + col] < NO_MATCH_COST)
+            assignment[r] = (int) col;
+    }
+}
+
+/*
+ * Shortest augmenting path version of the Hungarian algorithm, O(n^3).
+ * On return p_[col] is the (1-based) row assigned to col.
+ */
+void CDataAssociation::solve(size_t n)
+{
+    const double inf = std::numeric_limits<double>::max();
+
+    u_.assign(n + 1, 0.0);
+    v_.assign(n + 1, 0.0);
+    p_.assign(n + 1, 0);
+    way_.assign(n + 1, 0);
+
+    for(size_t i = 1; i <= n; i++)
+    {
+        p_[0] = i;
+        size_t j0 = 0;
+        minv_.assign(n + 1, inf);
+        used_.assign(n + 1, 0);
+
+        do
+        {
+            used_[j0] = 1;
+            size_t i0 = p_[j0], j1 = 0;
+            double delta = inf;
+            const float* row = &cost_[(i0 - 1) * n];
+
+            for(size_t j = 1; j <= n; j++)
+            {
+                if(used_[j]) continue;
+                double cur = row[j - 1] - u_[i0] - v_[j];
+                if(cur < minv_[j])
+                {
+                    minv_[j] = cur;
+                    way_[j] = j0;
+                }
+                if(minv_[j] < delta)
+                {
+                    delta = minv_[j];
+                    j1 = j;
+                }
+            }
+
+            for(size_t j = 0; j <= n; j++)
+            {
+                if(used_[j])
+                {
+                    u_[p_[j]] += delta;
+                    v_[j] -= delta;
+                }
+                else
+                {
+                    minv_[j] -= delta;
+                }
+            }
+            j0 = j1;
+        } while(p_[j0] != 0);
+
+        do
+        {
+            size_t j1 = way_[j0];
+            p_[j0] = p_[j1];
+            j0 = j1;
+        } while(j0);
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef DATAASSOCIATION_H
+#define DATAASSOCIATION_H
+
+#include <vector>
+#include <cstddef>
+#include "polarcord.h"
+
+/*
+ * Global nearest neighbour data association between tracked states and
+ * new measurements (both polar, in the sensor frame).
+ *
+ * A pair is a candidate if its squared Mahalanobis distance, with the
+ * state variance plus the measurement noise as covariance, is below the
+ * chi-square gate and the plain distance is below max_distance
+ * (meters, or radians in bearing-only mode). The candidates are then
+ * assigned all at once with the Hungarian algorithm, so two states can
+ * never claim the same measurement. States and measurements without any
+ * candidate are left out of the assignment problem. All buffers are kept
+ * between calls.
+ */
+
+enum AssociationMode_t
+{
+    ASSOCIATION_POLAR,      // range and bearing
+    ASSOCIATION_BEARING     // bearing only
+};
+
+class CDataAssociation
+{
+private:
+    AssociationMode_t mode_;
+    float noise_range_;     // measurement variance [m^2]
+    float noise_angle_;     // measurement variance [rad^2]
+    float gate_;            // on the squared Mahalanobis distance
+    float max_distance_;
+
+    std::vector<float> gated_;      // rows x cols, gated pairs only
+    std::vector<float> cost_;       // square, padded
+    std::vector<size_t> rows_;      // states with at least one candidate
+    std::vector<size_t> cols_;      // measurements with at least one candidate
+    std::vector<int> col_used_;
+    std::vector<int> row_assignment_;
+
+    // Hungarian algorithm, 1-based
+    std::vector<double> u_, v_, minv_;
+    std::vector<size_t> p_, way_;
+    std::vector<char> used_;
+
+    bool gatedCost(const PolarPose& state, const PolarPose& meas, float& cost) const;
+    void solve(size_t n);
+
+public:
+    static const float NO_MATCH_COST;
+
+    CDataAssociation(AssociationMode_t mode, float noise_range, float noise_angle,
+                     float gate, float max_distance);
+
+    /*
+     * assignment[i] is the measurement matched to states[i], or -1
+     * if none passed the gate.
+     */
+    void associate(const std::vector<PolarPose>& states,
+                   const std::vector<PolarPose>& meas,
+                   std::vector<int>& assignment);
+
+    /*
+     * Minimum cost assignment on a precomputed rows x cols (row-major) cost
+     * matrix, for callers with their own gating. Pairs costing NO_MATCH_COST
+     * are never assigned.
+     */
+    void assign(const std::vector<float>& cost, size_t rows, size_t cols,
+                std::vector<int>& assignment);
+};
+
+#endif // DATAASSOCIATION_H
@@ -0,0 +1,251 @@
+#include "gaussianmixture.h"
+#include <angles/angles.h>
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+const float NO_RANGE_INFORMATION = 20.0;    // [m] as in CGrid::updateGrid
+const float MAX_EXPONENT = 40.0;            // exp(-20) is as good as 0
+const size_t FIELDS = 4;
+
+bool poseByValue(const geometry_msgs::Pose& a, const geometry_msgs::Pose& b)
+{
+    return a.position.z > b.position.z;
+}
+}
+
+CGaussianMixture::CGaussianMixture():
+    weight_sum_(0.0)
+{
+}
+
+void CGaussianMixture::clear()
+{
+    components_.clear();
+    source_weight_.clear();
+    weight_sum_ = 0.0;
+}
+
+void CGaussianMixture::setStates(const std::vector<PolarPose>& states)
+{
+    clear();
+    components_.reserve(states.size());
+
+    MixtureComponent_t c;
+    c.source = 0;
+    for(size_t i = 0; i < states.size(); i++)
+    {
+        const PolarPose& p = states[i];
+        ROS_ASSERT(p.var_range > 0.0 && p.var_angle > 0.0);
+
+        c.range = p.range;
+        c.angle = angles::normalize_angle(p.angle);
+        c.inv_var_range = (p.range > NO_RANGE_INFORMATION) ? 0.0 : 1.0 / p.var_range;
+        c.inv_var_angle = 1.0 / p.var_angle;
+        components_.push_back(c);
+    }
+
+    source_weight_.push_back(1.0);
+    weight_sum_ = 1.0;
+}
+
+void CGaussianMixture::add(const CGaussianMixture& other, float weight)
+{
+    if(weight <= 0.0) return;
+
+    const size_t offset = source_weight_.size();
+    for(size_t s = 0; s < other.source_weight_.size(); s++)
+    {
+        source_weight_.push_back(weight * other.source_weight_[s]);
+        weight_sum_ += source_weight_.back();
+    }
+
+    for(size_t i = 0; i < other.components_.size(); i++)
+    {
+        components_.push_back(other.components_[i]);
+        components_.back().source += offset;
+    }
+}
+
+float CGaussianMixture::component(const MixtureComponent_t& c, float range, float angle) const
+{
+    const float da = angles::normalize_angle(angle - c.angle);
+    const float dr = range - c.range;
+    const float e = da * da * c.inv_var_angle + dr * dr * c.inv_var_range;
+    return (e > MAX_EXPONENT) ? 0.0 : exp(-0.5 * e);
+}
+
+/*
+ * Highest value of a component over the wedge angle +- half_width, along any
+ * range: its range term can always be brought to 1.
+ */
+float CGaussianMixture::angularComponent(const MixtureComponent_t& c, float angle, float half_width) const
+{
+    const float da = std::max(0.0, fabs(angles::normalize_angle(angle - c.angle)) - half_width);
+    const float e = da * da * c.inv_var_angle;
+    return (e > MAX_EXPONENT) ? 0.0 : exp(-0.5 * e);
+}
+
+float CGaussianMixture::value(float range, float angle) const
+{
+    if(components_.empty() || weight_sum_ <= 0.0) return 0.0;
+
+    float sum = 0.0;
+    float source_max = 0.0;
+    size_t source = components_[0].source;
+
+    for(size_t i = 0; i < components_.size(); i++)
+    {
+        const MixtureComponent_t& c = components_[i];
+        if(c.source != source)
+        {
+            sum += source_weight_[source] * source_max;
+            source_max = 0.0;
+            source = c.source;
+        }
+        source_max = std::max(source_max, component(c, range, angle));
+    }
+    sum += source_weight_[source] * source_max;
+
+    return sum / weight_sum_;
+}
+
+float CGaussianMixture::valueAt(float x, float y) const
+{
+    return value(sqrt(x * x + y * y), atan2(y, x));
+}
+
+size_t CGaussianMixture::peaks(float threshold, float min_distance, float ray_range,
+                               geometry_msgs::PoseArray& peaks) const
+{
+    peaks.poses.clear();
+
+    geometry_msgs::Pose pose;
+    pose.orientation.w = 1.0;
+    std::vector<geometry_msgs::Pose> candidates;
+    candidates.reserve(components_.size());
+
+    for(size_t i = 0; i < components_.size(); i++)
+    {
+        const MixtureComponent_t& c = components_[i];
+        const float r = (c.inv_var_range > 0.0) ? c.range : ray_range;
+        pose.position.x = r * cos(c.angle);
+        pose.position.y = r * sin(c.angle);
+        pose.position.z = value(r, c.angle);
+        if(pose.position.z >= threshold) candidates.push_back(pose);
+    }
+
+    std::sort(candidates.begin(), candidates.end(), poseByValue);
+
+    const float d2 = min_distance * min_distance;
+    for(size_t i = 0; i < candidates.size(); i++)
+    {
+        bool suppressed = false;
+        for(size_t j = 0; j < peaks.poses.size() && !suppressed; j++)
+        {
+            float dx = candidates[i].position.x - peaks.poses[j].position.x;
+            float dy = candidates[i].position.y - peaks.poses[j].position.y;
+            suppressed = (dx * dx + dy * dy < d2);
+        }
+        if(!suppressed) peaks.poses.push_back(candidates[i]);
+    }
+    return peaks.poses.size();
+}
+
+void CGaussianMixture::project(int angle_step, geometry_msgs::PoseArray& projection) const
+{
+    const size_t bins = 360 / angle_step;
+    const float half_width = angles::from_degrees(angle_step / 2.0);
+
+    projection.header.stamp = ros::Time::now();
+    projection.header.frame_id = "base_footprint";
+    projection.poses.resize(bins);
+
+    for(size_t i = 0; i < bins; i++)
+    {
+        geometry_msgs::Pose& pose = projection.poses[i];
+        pose.position.x = cos(i * M_PI / 180);
+        pose.position.y = sin(i * M_PI / 180);
+        pose.position.z = 0.0;
+
+        if(components_.empty() || weight_sum_ <= 0.0) continue;
+
+        const float centre = angles::from_degrees((i + 0.5) * angle_step);
+        float sum = 0.0;
+        float source_max = 0.0;
+        size_t source = components_[0].source;
+
+        // sources can peak at different ranges: an upper bound of the grid's maximum
+        for(size_t k = 0; k < components_.size(); k++)
+        {
+            const MixtureComponent_t& c = components_[k];
+            if(c.source != source)
+            {
+                sum += source_weight_[source] * source_max;
+                source_max = 0.0;
+                source = c.source;
+            }
+            source_max = std::max(source_max, angularComponent(c, centre, half_width));
+        }
+        sum += source_weight_[source] * source_max;
+        pose.position.z = sum / weight_sum_;
+    }
+}
+
+void CGaussianMixture::rasterise(const MapMetaData_t& map, std::vector<float>& grid) const
+{
+    grid.resize(map.cell.size());
+    for(size_t i = 0; i < map.cell.size(); i++)
+        grid[i] = value(map.cell[i].polar.range, map.cell[i].polar.angle);
+}
+
+void CGaussianMixture::toMessage(std_msgs::Float32MultiArray& msg) const
+{
+    msg.layout.dim.resize(2);
+    msg.layout.dim[0].label = "components";
+    msg.layout.dim[0].size = components_.size();
+    msg.layout.dim[0].stride = components_.size() * FIELDS;
+    msg.layout.dim[1].label = "range_angle_var_range_var_angle";
+    msg.layout.dim[1].size = FIELDS;
+    msg.layout.dim[1].stride = FIELDS;
+    msg.layout.data_offset = 0;
+
+    msg.data.resize(components_.size() * FIELDS);
+    for(size_t i = 0; i < components_.size(); i++)
+    {
+        const MixtureComponent_t& c = components_[i];
+        float* d = &msg.data[i * FIELDS];
+        d[0] = (c.inv_var_range > 0.0) ? c.range : std::max(c.range, NO_RANGE_INFORMATION + 1.0f);
+        d[1] = c.angle;
+        d[2] = (c.inv_var_range > 0.0) ? 1.0 / c.inv_var_range : 1.0;
+        d[3] = 1.0 / c.inv_var_angle;
+    }
+}
+
+bool CGaussianMixture::fromMessage(const std_msgs::Float32MultiArray& msg)
+{
+    if(msg.data.size() % FIELDS != 0)
+    {
+        ROS_WARN("Received a mixture of %lu values, expected a multiple of %lu.", msg.data.size(), FIELDS);
+        return false;
+    }
+
+    std::vector<PolarPose> states(msg.data.size() / FIELDS);
+    for(size_t i = 0; i < states.size(); i++)
+    {
+        const float* d = &msg.data[i * FIELDS];
+        if(!(d[2] > 0.0 && d[3] > 0.0))
+        {
+            ROS_WARN("Received a mixture component without a positive variance.");
+            return false;
+        }
+        states[i].range = d[0];
+        states[i].angle = d[1];
+        states[i].var_range = d[2];
+        states[i].var_angle = d[3];
+    }
+
+    setStates(states);
+    return true;
+}
@@ -0,0 +1,76 @@
+#ifndef GAUSSIANMIXTURE_H
+#define GAUSSIANMIXTURE_H
+
+#include <vector>
+#include <geometry_msgs/PoseArray.h>
+#include <std_msgs/Float32MultiArray.h>
+#include "grid.h"
+
+/*
+ * The predicted states of a grid node kept as what they are, a handful of
+ * Gaussians in range and angle, instead of the thousands of cells they are
+ * rasterised into by CGrid::updateGrid.
+ *
+ * The value of a source at a point is the one of the grid: the highest of its
+ * components, each scaled to 1 at its mean, with the range ignored for a
+ * component without range information (mean beyond 20 m). Sources are fused
+ * as CGridFusion does it linearly, sum(w value) / sum(w), so the mixture of
+ * the human node holds the components of every sensor with their weights.
+ *
+ * Point queries, peaks and projections are answered from the components; a
+ * grid is only rendered when someone asks for it.
+ */
+
+struct MixtureComponent_t{
+    float range;
+    float angle;
+    float inv_var_range;    // 0 without range information
+    float inv_var_angle;
+    size_t source;
+};
+
+class CGaussianMixture
+{
+private:
+    std::vector<MixtureComponent_t> components_;    // grouped by source
+    std::vector<float> source_weight_;
+    float weight_sum_;
+
+    float component(const MixtureComponent_t& c, float range, float angle) const;
+    float angularComponent(const MixtureComponent_t& c, float angle, float half_width) const;
+
+public:
+    CGaussianMixture();
+
+    void clear();
+    bool empty() const {return components_.empty();}
+    size_t size() const {return components_.size();}
+    size_t sources() const {return source_weight_.size();}
+    const std::vector<MixtureComponent_t>& components() const {return components_;}
+
+    // one source of weight 1 from the predicted states of a node
+    void setStates(const std::vector<PolarPose>& states);
+
+    // mixture-space fusion: the sources of other join with their weight scaled
+    void add(const CGaussianMixture& other, float weight);
+    void addAbsent(float weight) {if(weight > 0.0) weight_sum_ += weight;}  // a source without components
+
+    float value(float range, float angle) const;
+    float valueAt(float x, float y) const;
+
+    // component means (bearings at ray_range) scoring at least threshold,
+    // best first, none closer than min_distance to a better one; z is the value
+    size_t peaks(float threshold, float min_distance, float ray_range,
+                 geometry_msgs::PoseArray& peaks) const;
+
+    // highest value per angle bin, laid out as CGrid::projectGrid
+    void project(int angle_step, geometry_msgs::PoseArray& projection) const;
+
+    void rasterise(const MapMetaData_t& map, std::vector<float>& grid) const;
+
+    // [range, angle, var_range, var_angle] per component, source weights dropped
+    void toMessage(std_msgs::Float32MultiArray& msg) const;
+    bool fromMessage(const std_msgs::Float32MultiArray& msg);
+};
+
+#endif // GAUSSIANMIXTURE_H
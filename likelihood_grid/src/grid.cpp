@@ -33,6 +33,12 @@ float pointDistance(geometry_msgs::Point a, geometry_msgs::Point b)
     return ((float )sqrt( (a.x - b.x)*(a.x - b.x) + (a.y - b.y)*(a.y - b.y) ));
 }
 
+// local maxima poses carry their probability in z
+static bool posesByProbability(const geometry_msgs::Pose& a, const geometry_msgs::Pose& b)
+{
+    return (a.position.z < b.position.z);
+}
+
 
 float CGrid::pmfr(float u, float s, float x, float d)
 {
@@ -124,8 +130,8 @@ CGrid::CGrid(uint32_t map_size,
              x_.max,
              y_.max);
 
-    last_gm_.index = 0;
-    last_gm_.reset();
+    tracker_.setMeasurementNoise(map.resolution * map.resolution);
+    focus_id_ = 0;
 
     //    8 5 2
     //    7 4 1
@@ -176,6 +182,10 @@ CGrid::CGrid(uint32_t map_size,
     predicted_posterior_.resize(grid_size, cell_probability.unknown);
     predicted_true_likelihood_.resize(grid_size, cell_probability.unknown);
     predicted_false_likelihood_.resize(grid_size, cell_probability.unknown);
+    detection_likelihood_.resize(grid_size, cell_probability.unknown);
+    miss_detection_likelihood_.resize(grid_size, cell_probability.unknown);
+    in_fov_.assign(map.cell_inFOV.begin(), map.cell_inFOV.end());
+    log_odds_storage_ = false;
 
     setOutFOVProbability(posterior, cell_probability.unknown);
     setOutFOVProbability(true_likelihood_, cell_probability.unknown);
@@ -204,35 +214,58 @@ void CGrid::setInFOVProbability(std::vector<float>& data, const float val){
     }
 }
 
-void CGrid::computeLikelihood(const std::vector<PolarPose>& pose,
-                              std::vector<float> &_true_likelihood,
-                              std::vector<float> &_false_likelihood)
+void CGrid::cellLikelihood(size_t i, const std::vector<PolarPose>& pose,
+                           float& detection_likelihood, float& miss_detection_likelihood)
 {
     //    float range_guassian_factor = cell_probability.human / normalDistribution(0.0, 0.0, stdev.range);
     //    float angle_guassian_factor = cell_probability.human / normalDistribution(0.0, 0.0, toRadian(stdev.angle));
 
-    for(size_t i = 0; i < grid_size; i++){
-        float range = map.cell.at(i).polar.range;
-        float angle = map.cell.at(i).polar.angle;
-        float detection_likelihood = cell_probability.unknown;
-        float miss_detection_likelihood = cell_probability.unknown;
-
-        float cell_prob = 0.0;
-        if(map.cell_inFOV.at(i)){
-            if(pose.empty()) miss_detection_likelihood = cell_probability.human; // ?????
-
-            else{
-                for(size_t p = 0; p < pose.size(); p++){
-                    float Gr = (pose.at(p).range < 0.01) ? 1.0 : normalDistribution(range, pose.at(p).range, stdev.range);
-                    float Ga = normalDistribution(angle, pose.at(p).angle, angles::from_degrees(stdev.angle));
-                    cell_prob += Gr * Ga;
-                }
-                detection_likelihood = (((cell_prob)/(pose.size()) < cell_probability.free) ? cell_probability.free : (cell_prob)/(pose.size()));
+    float range = map.cell.at(i).polar.range;
+    float angle = map.cell.at(i).polar.angle;
+    detection_likelihood = cell_probability.unknown;
+    miss_detection_likelihood = cell_probability.unknown;
+
+    float cell_prob = 0.0;
+    if(in_fov_[i]){
+        if(pose.empty()) miss_detection_likelihood = cell_probability.human; // ?????
+
+        else{
+            for(size_t p = 0; p < pose.size(); p++){
+                float Gr = (pose.at(p).range < 0.01) ? 1.0 : normalDistribution(range, pose.at(p).range, stdev.range);
+                float Ga = normalDistribution(angle, pose.at(p).angle, angles::from_degrees(stdev.angle));
+                cell_prob += Gr * Ga;
             }
+            detection_likelihood = (((cell_prob)/(pose.size()) < cell_probability.free) ? cell_probability.free : (cell_prob)/(pose.size()));
         }
+    }
+}
+
+void CGrid::computeLikelihood(const std::vector<PolarPose>& pose,
+                              std::vector<float> &_true_likelihood,
+                              std::vector<float> &_false_likelihood)
+{
+    for(size_t i = 0; i < grid_size; i++)
+        cellLikelihood(i, pose, detection_likelihood_[i], miss_detection_likelihood_[i]);
 
-        _true_likelihood[i] = (detection_likelihood * TARGET_DETECTION_PROBABILITY_) + (miss_detection_likelihood * (1.0 - TARGET_DETECTION_PROBABILITY_));
-        _false_likelihood[i] = (detection_likelihood * FALSE_DETECTION_PROBABILITY_) + (miss_detection_likelihood * (1.0 - FALSE_DETECTION_PROBABILITY_));
+    if(grid_size == NodeGridSpec::cells)
+        likelihoodMixKernel<NodeGridSpec::cells>(grid_size, &detection_likelihood_[0], &miss_detection_likelihood_[0],
+                                                 TARGET_DETECTION_PROBABILITY_, FALSE_DETECTION_PROBABILITY_,
+                                                 &_true_likelihood[0], &_false_likelihood[0]);
+    else
+        likelihoodMixKernel<0>(grid_size, &detection_likelihood_[0], &miss_detection_likelihood_[0],
+                               TARGET_DETECTION_PROBABILITY_, FALSE_DETECTION_PROBABILITY_,
+                               &_true_likelihood[0], &_false_likelihood[0]);
+}
+
+void CGrid::computeLogLikelihoodRatio(const std::vector<PolarPose>& pose, std::vector<int16_t>& llr)
+{
+    float detection, miss_detection;
+    for(size_t i = 0; i < grid_size; i++){
+        cellLikelihood(i, pose, detection, miss_detection);
+        float t = detection * TARGET_DETECTION_PROBABILITY_ + miss_detection * (1.0 - TARGET_DETECTION_PROBABILITY_);
+        float f = detection * FALSE_DETECTION_PROBABILITY_ + miss_detection * (1.0 - FALSE_DETECTION_PROBABILITY_);
+        float l = LOG_ODDS_SCALE * log(t / f);
+        llr[i] = (int16_t) floor(std::min(std::max(l, -32767.0f), 32767.0f) + 0.5);
     }
 }
 
@@ -244,19 +277,15 @@ void CGrid::updateGridProbability(std::vector<float>& _prior,
 {
     // POSTERIOR = TARGET LOCALIZATION PROBABILITY
 
-    float normalizer_factor = 1.0;
-
-    for(size_t i = 0; i < grid_size; i++){
-
-        normalizer_factor = (_true_likelihood[i] * _prior[i]) + (_false_likelihood[i] * (1.0 - _prior[i]));
-        _posterior[i] = (_true_likelihood[i] * _prior[i]) / normalizer_factor;
-        _posterior[i] = (_posterior[i] > cell_probability.human) ? _posterior[i] * cell_probability.human : _posterior[i];
-        _posterior[i] = (_posterior[i] < cell_probability.free) ? cell_probability.free : _posterior[i];
-
-        //PROBABILITY IN unknown AREA CANNOT BE LESS THAN unknown PROBABILITY
-        if((!map.cell_inFOV.at(i)) && (_posterior[i] < cell_probability.unknown ))
-        {_posterior[i] = cell_probability.unknown;}
-    }
+    // The grid of the nodes has a fixed size, use the kernel specialised for it
+    if(grid_size == NodeGridSpec::cells)
+        bayesUpdateKernel<NodeGridSpec::cells>(grid_size, &_prior[0], &_true_likelihood[0], &_false_likelihood[0],
+                                               &in_fov_[0], cell_probability.free, cell_probability.unknown,
+                                               cell_probability.human, &_posterior[0]);
+    else
+        bayesUpdateKernel<0>(grid_size, &_prior[0], &_true_likelihood[0], &_false_likelihood[0],
+                             &in_fov_[0], cell_probability.free, cell_probability.unknown,
+                             cell_probability.human, &_posterior[0]);
 }
 
 void CGrid::updateGrid(int score)
@@ -370,8 +399,98 @@ void CGrid::projectGrid()
 
 }
 
+void CGrid::setLogOddsStorage(bool enable)
+{
+    if(enable == log_odds_storage_) return;
+    log_odds_storage_ = enable;
+
+    if(enable){
+        /*
+         * The probability clamps of updateGridProbability become bounds on
+         * the log-odds; out of the FOV a cell can not drop below unknown.
+         */
+        log_odds_upper_ = toLogOdds(cell_probability.human);
+        int16_t in_fov_lower = toLogOdds(cell_probability.free);
+        int16_t out_fov_lower = std::min(toLogOdds(cell_probability.unknown), log_odds_upper_);
+
+        log_odds_lower_.resize(grid_size);
+        log_odds_.resize(grid_size);
+        log_likelihood_ratio_.resize(grid_size);
+        for(size_t i = 0; i < grid_size; i++){
+            log_odds_lower_[i] = (in_fov_[i]) ? in_fov_lower : out_fov_lower;
+            log_odds_[i] = std::min(std::max(toLogOdds(prior[i]), log_odds_lower_[i]), log_odds_upper_);
+        }
+
+        /* Every value the state can take, to get back to probabilities without exp() */
+        int16_t table_lower = std::min(in_fov_lower, out_fov_lower);
+        log_odds_table_.resize(log_odds_upper_ - table_lower + 1);
+        for(size_t l = 0; l < log_odds_table_.size(); l++)
+            log_odds_table_[l] = fromLogOdds(table_lower + l);
+
+        // posterior stays the float output of the grid, the rest is released
+        std::vector<float>().swap(prior);
+        std::vector<float>().swap(true_likelihood_);
+        std::vector<float>().swap(false_likelihood_);
+        std::vector<float>().swap(predicted_posterior_);
+        std::vector<float>().swap(predicted_true_likelihood_);
+        std::vector<float>().swap(predicted_false_likelihood_);
+        std::vector<float>().swap(detection_likelihood_);
+        std::vector<float>().swap(miss_detection_likelihood_);
+    }else{
+        prior.resize(grid_size);
+        for(size_t i = 0; i < grid_size; i++) prior[i] = fromLogOdds(log_odds_[i]);
+
+        true_likelihood_.resize(grid_size, cell_probability.unknown);
+        false_likelihood_.resize(grid_size, cell_probability.unknown);
+        predicted_posterior_.resize(grid_size, cell_probability.unknown);
+        predicted_true_likelihood_.resize(grid_size, cell_probability.unknown);
+        predicted_false_likelihood_.resize(grid_size, cell_probability.unknown);
+        detection_likelihood_.resize(grid_size, cell_probability.unknown);
+        miss_detection_likelihood_.resize(grid_size, cell_probability.unknown);
+
+        std::vector<int16_t>().swap(log_odds_);
+        std::vector<int16_t>().swap(log_odds_lower_);
+        std::vector<int16_t>().swap(log_likelihood_ratio_);
+        std::vector<float>().swap(log_odds_table_);
+    }
+}
+
+void CGrid::updateLogOdds(const std::vector<PolarPose>& pose)
+{
+    computeLogLikelihoodRatio(pose, log_likelihood_ratio_);
+    int16_t max_log_odds = logOddsUpdateKernel(grid_size, &log_odds_[0], &log_likelihood_ratio_[0], &log_odds_lower_[0]);
+    if(max_log_odds <= log_odds_upper_) return;
+
+    // same as updateGridProbability: above human the probability is scaled down by human
+    for(size_t i = 0; i < grid_size; i++){
+        if(log_odds_[i] <= log_odds_upper_) continue;
+        int16_t l = toLogOdds(fromLogOdds(log_odds_[i]) * cell_probability.human);
+        log_odds_[i] = std::min(std::max(l, log_odds_lower_[i]), log_odds_upper_);
+    }
+}
+
+void CGrid::bayesLogOddsFilter()
+{
+    // PREDICTION BY MOTION MODEL
+    updateLogOdds(polar_array.predicted);
+
+    // UPDATE BY OBSERVATION
+    updateLogOdds(polar_array.current);
+
+    const int16_t table_begin = log_odds_upper_ - (int16_t) log_odds_table_.size() + 1;
+    for(size_t i = 0; i < grid_size; i++) posterior[i] = log_odds_table_[log_odds_[i] - table_begin];
+
+    polar_array.past = polar_array.current;
+    max_probability_ = posterior.at(maxProbCellIndex());
+}
+
 void CGrid::bayesOccupancyFilter()
 {
+    if(log_odds_storage_){
+        bayesLogOddsFilter();
+        return;
+    }
+
     // PREDICTION BY MOTION MODEL
     computeLikelihood(polar_array.predicted, predicted_true_likelihood_, predicted_false_likelihood_);
     updateGridProbability(prior, predicted_true_likelihood_, predicted_false_likelihood_, predicted_posterior_);
@@ -386,27 +505,6 @@ void CGrid::bayesOccupancyFilter()
 }
 
 
-void CGrid::fuse(const std::vector<float> &data_1,
-                 const std::vector<float> &data_2,
-                 const std::vector<float> &data_3,
-                 bool multiply)
-{
-    //TODO: FIX THIS
-    if(multiply){
-
-        setInFOVProbability(posterior, 1.0);
-        setOutFOVProbability(posterior, 1.0);
-        for(size_t i = 0; i < grid_size; i++){
-            posterior.at(i) = (data_1.at(i) * data_2.at(i) * data_3.at(i));}
-    } else {
-        setInFOVProbability(posterior, 0.0);
-        setOutFOVProbability(posterior, 0.0);
-        for(size_t i = 0; i < grid_size; i++)
-        {posterior.at(i) = (data_1.at(i) + data_2.at(i) + data_3.at(i))/3.0;}
-    }
-}
-
-
 void CGrid::getPose(geometry_msgs::PoseArray& crtsn_array)
 {
     if(!polar_array.current.empty()) polar_array.current.clear();
@@ -550,7 +648,14 @@ size_t CGrid::maxProbCellIndex()
     float max = posterior.at(0);
     size_t _cell_index = 0;
 
-    for(size_t i = 1; i < grid_size; i++){ _cell_index = (max < posterior.at(i)) ? i : _cell_index;}
+    for(size_t i = 1; i < grid_size; i++)
+    {
+        if(max < posterior.at(i))
+        {
+            max = posterior.at(i);
+            _cell_index = i;
+        }
+    }
     return _cell_index;
 }
 
@@ -585,8 +690,8 @@ void CGrid::getLocalMaximas()
             lm_new.index = i;
             lm_new.probability = posterior.at(i);
 
-            uint8_t col = i / map.height;
-            uint8_t row = i % map.height;
+            int col = i / map.height;
+            int row = i % map.height;
             is_local_maxima = false;
 
             for(int8_t c = -ss; c <= ss; c++)
@@ -641,238 +746,75 @@ terminate_search:
 
 void CGrid::trackLocalMaximas()
 {
-    int8_t counter_threshold = 10;
-    float dist_threshold = 1.0;
-
-    main_lms_.clear();
-    matched_lms_.clear();
-
-    if(old_lms_.empty())
-    {
-        old_lms_.assign(new_lms_.begin(), new_lms_.end());
-        return;
-    }
-
-    for(std::vector<LocalMaxima_t>::iterator k = old_lms_.begin(); k != old_lms_.end(); k++)
-    {
-        if(k->probability < 1e-4) { old_lms_.erase(k); }
-    }
-
-    matched_lms_.assign(old_lms_.begin(), old_lms_.end());
-
-    for(size_t ni = 0; ni < new_lms_.size(); ni++)
-    {
-        bool new_lm_match = false;
-
-        for(size_t oi = 0; oi < matched_lms_.size(); oi++)
-        {
-
-            if(cellsDistance(new_lms_.at(ni).index, matched_lms_.at(oi).index) < dist_threshold)
-            {
-                matched_lms_.at(oi).index = new_lms_.at(ni).index;
-                matched_lms_.at(oi).probability = posterior.at(new_lms_.at(ni).index);
-
-                if(++matched_lms_.at(oi).counter > counter_threshold)
-                {
-                    matched_lms_.at(oi).tracking = true;
-                    matched_lms_.at(oi).counter = counter_threshold + 1;
-                }
-                new_lm_match = true;
-                continue;
-            }
-        }
-
-        /* It there is no match for this new local maxima with any of the old maximas
-         * push that into matched_lms_
-         */
-
-        if(!new_lm_match)
-        {
-            LocalMaxima_t lm_not_matched;
-            lm_not_matched.index = new_lms_.at(ni).index;
-            lm_not_matched.reset();
-            lm_not_matched.probability = new_lms_.at(ni).probability;
-            matched_lms_.push_back(lm_not_matched);
-        }
-    }
-    ROS_ASSERT(old_lms_.size() <= matched_lms_.size());
-
-    /* If there were no match for this old local maxima with any of the new local maximas
-     * decrease its counter
-     */
-
-    for(size_t k = 0; k < old_lms_.size(); k++)
-    {
-        if(matched_lms_.at(k).counter == old_lms_.at(k).counter)
-        {
-            matched_lms_.at(k).counter--;
-        }
-    }
-
-    old_lms_.clear();
-
-    if(!matched_lms_.empty())
+    /* The local maxima are the measurements of the people tracker */
+    lms_measurements_.resize(new_lms_.size());
+    for(size_t i = 0; i < new_lms_.size(); i++)
     {
-        for(std::vector<LocalMaxima_t>::iterator a = matched_lms_.begin();
-            a != matched_lms_.end(); a++)
-        {
-            LocalMaxima_t l = *a;
-
-    /*
-    //        if(matched_lms_.at(a).probability < 1e-4)
-    //        {
-    //            matched_lms_.at(a).counter = 0.0;
-    //            matched_lms_.at(a).tracking = false;
-    //        }
-
-
-    //        if(matched_lms_.at(a).counter <= 0)
-    //        {
-    //            matched_lms_.at(a).tracking = false;
-    //        }
-    //        else
-    //        {
-    //            if(matched_lms_.at(a).counter > counter_threshold)
-    //            {
-    //                matched_lms_.at(a).counter = counter_threshold + 1;
-    //                matched_lms_.at(a).tracking = true;
-    //            }
-    //            old_lms_.push_back(matched_lms_.at(a));
-    //        }
-    */
-            if(l.counter <= 0)
-            {
-                matched_lms_.erase( a);
-            }
-            else{
-                old_lms_.push_back(l);
-
-
-                if(l.tracking == true )
-                {
-                    main_lms_.push_back(l);
-                }
-            }
-        }
+        size_t in = new_lms_.at(i).index;
+        lms_measurements_.at(i).x = map.cell.at(in).cartesian.x;
+        lms_measurements_.at(i).y = map.cell.at(in).cartesian.y;
+        lms_measurements_.at(i).probability = posterior.at(in);
     }
 
+    tracker_.update(lms_measurements_, diff_time.toSec());
 
-    // For disable tracking uncomment these two lines:
-//    main_lms_.clear();
-//    main_lms_.assign(new_lms_.begin(), new_lms_.end());
-
-    std::sort (main_lms_.begin(), main_lms_.end());
-
+    /* Confirmed tracks, lowest probability first */
     local_maxima_poses.poses.clear();
     geometry_msgs::Pose pose;
 
-    for(size_t j = 0; j < main_lms_.size(); j++)
+    const std::vector<HumanTrack_t>& tracks = tracker_.tracks();
+    for(size_t j = 0; j < tracks.size(); j++)
     {
-        uint in = main_lms_.at(j).index;
-        pose.position.x = map.cell.at(in).cartesian.x;
-        pose.position.y = map.cell.at(in).cartesian.y;
-        pose.position.z = main_lms_.at(j).probability;
+        if(!tracks.at(j).confirmed) continue;
+        pose.position.x = tracks.at(j).state[0];
+        pose.position.y = tracks.at(j).state[1];
+        pose.position.z = tracks.at(j).probability;
         local_maxima_poses.poses.push_back(pose);
     }
+    std::sort(local_maxima_poses.poses.begin(), local_maxima_poses.poses.end(), posesByProbability);
 
     local_maxima_poses.header.frame_id = "base_footprint";
     local_maxima_poses.header.stamp = ros::Time::now();
-
-
 }
 
 void CGrid::trackMaxProbability()
 {
-    uint8_t loop_rate = 2;
-    int8_t counter_threshold = 1 * loop_rate;
-    float dist_threshold = 0.5;
-    float tracking_distance = dist_threshold;
-
-    /* Find the cell with highest probability*/
-    size_t gm_index = 0;
-    for(size_t i = 0; i < main_lms_.size(); i++)
+    /*
+     * Follow the most probable confirmed track. Switch to another one only if
+     * it is more than 1% more probable, or if the followed one is gone.
+     */
+    const std::vector<HumanTrack_t>& tracks = tracker_.tracks();
+    const HumanTrack_t* best = NULL;
+    for(size_t i = 0; i < tracks.size(); i++)
     {
-        size_t in = main_lms_.at(i).index;
-        gm_index = (posterior.at(in) > posterior.at(gm_index)) ? in : gm_index;
+        if(!tracks.at(i).confirmed) continue;
+        if(!best || tracks.at(i).probability > best->probability) best = &tracks.at(i);
     }
 
-    /* If there were no last gm */
-    if(last_gm_.index == 0) last_gm_.index = (main_lms_.empty()) ? last_gm_.index : gm_index;
-/*
-    Velocity_t robot_max_velocity;
-    robot_max_velocity.linear = 1.0; //TODO: MAKE THESE PARAMETERS
-    robot_max_velocity.angular = 1.0;
-
-    float range1 = map.cell.at(gm_index).polar.range;
-    float range2 = map.cell.at(last_gm_.index).polar.range;
-    float min_range = (range1 + range2) / 2.0;
-
-    float max_angular_distance = robot_max_velocity.angular * diff_time.toSec() * min_range;
-    float max_linear_distance = robot_max_velocity.linear * diff_time.toSec();
-    tracking_distance = std::max(dist_threshold, std::max(max_linear_distance, max_angular_distance));
-    */
-
-    if(cellsDistance(gm_index, last_gm_.index) < tracking_distance)
+    const HumanTrack_t* focus = tracker_.find(focus_id_);
+    if(best && (!focus || !focus->confirmed ||
+                (best->probability - focus->probability) > 0.01 * best->probability))
     {
-        last_gm_.index = gm_index;
-        last_gm_.counter++;
-        last_gm_.probability = posterior.at(gm_index);
-    }
-    else
-    {
-        if((posterior.at(gm_index) - posterior.at(last_gm_.index)) > 0.01 * posterior.at(gm_index))
-        {
-            last_gm_.counter--;
-        }
+        focus = best;
     }
 
-    if(last_gm_.counter > counter_threshold)
-    {
-        last_gm_.tracking = true;
-        last_gm_.counter = counter_threshold + 1;
-        goto stop;
-    }
-    else if(last_gm_.counter < 0)
+    if(focus && focus->confirmed)
     {
-        last_gm_.index = gm_index;
-        last_gm_.counter = counter_threshold + 1;
-        last_gm_.probability = posterior.at(gm_index);
-        goto stop;
+        focus_id_ = focus->id;
+        highest_prob_point.point.x = focus->state[0];
+        highest_prob_point.point.y = focus->state[1];
+        highest_prob_point.point.z = focus->probability;
     }
     else
     {
-        /*
-        size_t predicted_highest_lm = predictObjectPosition(last_gm_.index);
-        size_t temp_lm = last_gm_.index;
-
-        for(size_t i = 0; i < main_lms_.size(); i++){
-
-            float dist = cellsDistance(main_lms_.at(i).index, predicted_highest_lm);
-            temp_lm = (dist > tracking_distance) ? temp_lm : main_lms_.at(i).index;
-        }
-
-        last_gm_.index = (fabs(velocity_.linear) > 1e-4 || fabs(velocity_.angular) > 1e-4)
-                ? temp_lm : last_gm_.index;
-                */
-        goto stop;
+        /* No one to follow, fall back to the maximum of the posterior */
+        focus_id_ = 0;
+        size_t in = maxProbCellIndex();
+        highest_prob_point.point.x = map.cell.at(in).cartesian.x;
+        highest_prob_point.point.y = map.cell.at(in).cartesian.y;
+        highest_prob_point.point.z = posterior.at(in);
     }
 
-//    if(!main_lms_.empty())
-//    {
-
-//        for(size_t i = 0; i < main_lms_.size(); i++){
-//            size_t in = main_lms_.at(i).index;
-//            gm_index = (posterior.at(in) > posterior.at(gm_index)) ? in : gm_index;
-//        }
-//    }
-//        last_gm_.index = gm_index;
-//        last_gm_.tracking = true;
-
-stop:
-
-    highest_prob_point.point.x = map.cell.at(last_gm_.index).cartesian.x;
-    highest_prob_point.point.y = map.cell.at(last_gm_.index).cartesian.y;
-    highest_prob_point.point.z = posterior.at(last_gm_.index);
     highest_prob_point.header.frame_id = "base_footprint";
     highest_prob_point.header.stamp = ros::Time::now();
 }
@@ -19,6 +19,9 @@
 #include <autonomy_human/raw_detections.h>
 #include <nav_msgs/OccupancyGrid.h>
 #include "polarcord.h"
+#include "gridspec.h"
+#include "gridlogodds.h"
+#include "multitracker.h"
 #include <visualization_msgs/Marker.h>
 #include <visualization_msgs/MarkerArray.h>
 
@@ -26,6 +29,8 @@ float normalize(const float val, const float x_min, const float x_max, const flo
 
 float pointDistance(geometry_msgs::Point a, geometry_msgs::Point b);
 
+float normalDistribution(const float x, const float u, const float s);
+
 struct FOV_t{
     float min;
     float max;
@@ -71,6 +76,12 @@ struct Velocity_t{
     float angular;
 };
 
+struct Pose2D_t{
+    float x;
+    float y;
+    float yaw;
+};
+
 struct MapMetaData_t{
 float resolution; // The map resolution [m/cell]
 uint32_t width; //Map width [cells]
@@ -98,24 +109,39 @@ private:
     int angle_bins;
 
     float cellsDistance(size_t c1, size_t c2);
-    std::vector<LocalMaxima_t> old_lms_;
     std::vector<LocalMaxima_t> new_lms_;
-    std::vector<LocalMaxima_t> matched_lms_;
-    std::vector<LocalMaxima_t> main_lms_;
+    std::vector<TrackMeasurement_t> lms_measurements_;
+    CMultiTargetTracker tracker_;
+    uint32_t focus_id_;                     // track reported as the highest probability point
 
     std::vector<float> true_likelihood_;
     std::vector<float> false_likelihood_;
     std::vector<float> predicted_posterior_;
     std::vector<float> predicted_true_likelihood_;
     std::vector<float> predicted_false_likelihood_;
+    std::vector<float> detection_likelihood_;
+    std::vector<float> miss_detection_likelihood_;
+    std::vector<uint8_t> in_fov_;           // map.cell_inFOV unpacked for the kernels
+
+    // compact storage mode: fixed-point log-odds instead of the float vectors
+    bool log_odds_storage_;
+    std::vector<int16_t> log_odds_;
+    std::vector<int16_t> log_odds_lower_;
+    std::vector<int16_t> log_likelihood_ratio_;
+    int16_t log_odds_upper_;
+    std::vector<float> log_odds_table_;     // log-odds -> probability, from the lowest lower bound up to the upper
 
-    LocalMaxima_t last_gm_;
     Velocity_t velocity_;
     Velocity_t last_velocity_;
 
     float TARGET_DETECTION_PROBABILITY_;
     float FALSE_DETECTION_PROBABILITY_;
 
+    void cellLikelihood(size_t i, const std::vector<PolarPose>& pose,
+                        float& detection_likelihood, float& miss_detection_likelihood);
+    void computeLogLikelihoodRatio(const std::vector<PolarPose>& pose, std::vector<int16_t>& llr);
+    void updateLogOdds(const std::vector<PolarPose>& pose);
+    void bayesLogOddsFilter();
     void computeLikelihood(const std::vector<PolarPose>& pose,
                                 std::vector<float> &_true_likelihood,
                                 std::vector<float> &_false_likelihood);
@@ -166,9 +192,9 @@ public:
     CGrid();
     ~CGrid();
 
-    void fuse(const std::vector<float> &data_1, const std::vector<float> &data_2,
-              const std::vector<float> &data_3, bool multiply);
     void bayesOccupancyFilter();
+    void setLogOddsStorage(bool enable);    // prior is not available while enabled
+    bool logOddsStorage() const {return log_odds_storage_;}
     void getPose(geometry_msgs::PoseArray &crtsn_array);
     void getPose(const autonomy_human::raw_detectionsConstPtr torso_img);
     void getPose(const hark_msgs::HarkSourceConstPtr& sound_src);
@@ -178,6 +204,8 @@ public:
                      geometry_msgs::PoseArray &crtsn_array);
     void updateLocalMaximas();
     void trackMaxProbability();
+    const CMultiTargetTracker& tracker() const {return tracker_;}
+    uint32_t focusId() const {return focus_id_;}
     void updateGrid(int score);
     size_t maxProbCellIndex();
     void projectGrid();
@@ -0,0 +1,212 @@
+#include "griddelta.h"
+#include <cstdlib>
+#include <algorithm>
+
+CGridDeltaPublisher::CGridDeltaPublisher():
+    enabled_(false),
+    cycle_(0),
+    keyframe_period_(10),
+    tile_size_(8),
+    deadband_(1),
+    max_update_ratio_(0.5)
+{
+}
+
+void CGridDeltaPublisher::init(ros::NodeHandle& n, const std::string& topic, bool enabled,
+                               int keyframe_period, int tile_size, int deadband,
+                               float max_update_ratio)
+{
+    ROS_ASSERT(keyframe_period > 0 && tile_size > 0 && deadband >= 0);
+
+    enabled_ = enabled;
+    keyframe_period_ = keyframe_period;
+    tile_size_ = tile_size;
+    deadband_ = deadband;
+    max_update_ratio_ = max_update_ratio;
+    cycle_ = 0;
+
+    grid_pub_ = n.advertise<nav_msgs::OccupancyGrid>(topic, 10);
+    if(enabled_)
+    {
+        update_pub_ = n.advertise<map_msgs::OccupancyGridUpdate>(topic + "_updates", 10);
+        ROS_INFO("Publishing %s as keyframes every %d cycles plus incremental updates.",
+                 topic.c_str(), keyframe_period_);
+    }
+}
+
+uint32_t CGridDeltaPublisher::getNumSubscribers() const
+{
+    return grid_pub_.getNumSubscribers() + ((enabled_) ? update_pub_.getNumSubscribers() : 0);
+}
+
+bool CGridDeltaPublisher::sameGeometry(const nav_msgs::OccupancyGrid& grid)
+{
+    const geometry_msgs::Pose& a = last_sent_.info.origin;
+    const geometry_msgs::Pose& b = grid.info.origin;
+
+    /* A moved grid needs a new keyframe, its cells are not the same places */
+    return (a.position.x == b.position.x && a.position.y == b.position.y &&
+            a.position.z == b.position.z &&
+            a.orientation.x == b.orientation.x && a.orientation.y == b.orientation.y &&
+            a.orientation.z == b.orientation.z && a.orientation.w == b.orientation.w &&
+            last_sent_.info.width == grid.info.width &&
+            last_sent_.info.height == grid.info.height &&
+            last_sent_.info.resolution == grid.info.resolution &&
+            last_sent_.header.frame_id == grid.header.frame_id &&
+            last_sent_.data.size() == grid.data.size());
+}
+
+void CGridDeltaPublisher::publishKeyframe(const nav_msgs::OccupancyGrid& grid)
+{
+    last_sent_ = grid;
+    grid_pub_.publish(grid);
+}
+
+size_t CGridDeltaPublisher::markDirtyTiles(const nav_msgs::OccupancyGrid& grid,
+                                           uint32_t tiles_x, uint32_t tiles_y)
+{
+    dirty_tiles_.assign(tiles_x * tiles_y, false);
+
+    size_t dirty_cells = 0;
+    const uint32_t width = grid.info.width;
+
+    for(uint32_t y = 0; y < grid.info.height; y++)
+    {
+        const int8_t* now = &grid.data[y * width];
+        const int8_t* sent = &last_sent_.data[y * width];
+        const uint32_t tile_row = (y / tile_size_) * tiles_x;
+
+        for(uint32_t x = 0; x < width; x++)
+        {
+            if(abs(now[x] - sent[x]) > deadband_)
+            {
+                dirty_tiles_[tile_row + x / tile_size_] = true;
+                dirty_cells++;
+            }
+        }
+    }
+    return dirty_cells;
+}
+
+void CGridDeltaPublisher::publishRect(const nav_msgs::OccupancyGrid& grid,
+                                      uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+    update_.header = grid.header;
+    update_.x = x;
+    update_.y = y;
+    update_.width = width;
+    update_.height = height;
+    update_.data.resize(width * height);
+
+    for(uint32_t r = 0; r < height; r++)
+    {
+        size_t src = (y + r) * grid.info.width + x;
+        for(uint32_t c = 0; c < width; c++)
+        {
+            update_.data[r * width + c] = grid.data[src + c];
+            last_sent_.data[src + c] = grid.data[src + c];
+        }
+    }
+
+    update_pub_.publish(update_);
+}
+
+void CGridDeltaPublisher::publish(const nav_msgs::OccupancyGrid& grid)
+{
+    if(!enabled_)
+    {
+        grid_pub_.publish(grid);
+        return;
+    }
+
+    if(grid.data.size() != grid.info.width * grid.info.height)
+    {
+        ROS_WARN("Grid data does not match its size, can not compute delta.");
+        grid_pub_.publish(grid);
+        return;
+    }
+
+    bool keyframe = (cycle_ % keyframe_period_ == 0) || !sameGeometry(grid);
+    cycle_++;
+
+    if(keyframe)
+    {
+        publishKeyframe(grid);
+        return;
+    }
+
+    uint32_t tiles_x = (grid.info.width + tile_size_ - 1) / tile_size_;
+    uint32_t tiles_y = (grid.info.height + tile_size_ - 1) / tile_size_;
+
+    size_t dirty_cells = markDirtyTiles(grid, tiles_x, tiles_y);
+    if(dirty_cells == 0) return;
+
+    if(dirty_cells > max_update_ratio_ * grid.data.size())
+    {
+        publishKeyframe(grid);
+        return;
+    }
+
+    /* Merge horizontal runs of dirty tiles into one rectangle */
+    for(uint32_t ty = 0; ty < tiles_y; ty++)
+    {
+        uint32_t tx = 0;
+        while(tx < tiles_x)
+        {
+            if(!dirty_tiles_[ty * tiles_x + tx]) { tx++; continue; }
+
+            uint32_t run_begin = tx;
+            while(tx < tiles_x && dirty_tiles_[ty * tiles_x + tx]) tx++;
+
+            uint32_t x = run_begin * tile_size_;
+            uint32_t y = ty * tile_size_;
+            uint32_t width = std::min(tx * tile_size_, grid.info.width) - x;
+            uint32_t height = std::min(y + tile_size_, grid.info.height) - y;
+
+            publishRect(grid, x, y, width, height);
+        }
+    }
+}
+
+
+CGridReassembler::CGridReassembler():
+    has_keyframe_(false)
+{
+}
+
+void CGridReassembler::gridCallBack(const nav_msgs::OccupancyGridConstPtr& msg)
+{
+    grid_ = *msg;
+    keyframe_stamp_ = msg->header.stamp;
+    has_keyframe_ = true;
+}
+
+void CGridReassembler::updateCallBack(const map_msgs::OccupancyGridUpdateConstPtr& msg)
+{
+    if(!has_keyframe_) return; // wait for the first keyframe
+
+    if(msg->header.stamp < keyframe_stamp_)
+    {
+        ROS_DEBUG("Dropping grid update older than the last keyframe.");
+        return;
+    }
+
+    if(msg->x < 0 || msg->y < 0 ||
+            msg->x + msg->width > grid_.info.width ||
+            msg->y + msg->height > grid_.info.height ||
+            msg->data.size() != msg->width * msg->height)
+    {
+        ROS_WARN("Dropping grid update outside of the last keyframe.");
+        return;
+    }
+
+    for(uint32_t r = 0; r < msg->height; r++)
+    {
+        size_t dst = (msg->y + r) * grid_.info.width + msg->x;
+        std::copy(msg->data.begin() + r * msg->width,
+                  msg->data.begin() + (r + 1) * msg->width,
+                  grid_.data.begin() + dst);
+    }
+
+    grid_.header.stamp = msg->header.stamp;
+}
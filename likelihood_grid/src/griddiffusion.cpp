@@ -0,0 +1,108 @@
+#include "griddiffusion.h"
+#include <cmath>
+
+CGridDiffusion::CGridDiffusion():
+    height_(0),
+    width_(0),
+    min_sigma_(0.5),
+    sigma_(-1.0),
+    B_(1.0),
+    b1_(0.0),
+    b2_(0.0),
+    b3_(0.0)
+{
+}
+
+void CGridDiffusion::init(const MapMetaData_t& map, float min_sigma)
+{
+    ROS_ASSERT(map.height > 0 && map.width > 0 && min_sigma >= 0.5);
+
+    height_ = map.height;
+    width_ = map.width;
+    min_sigma_ = min_sigma;
+    sigma_ = -1.0;
+    transposed_.resize(height_ * width_);
+}
+
+void CGridDiffusion::setSigma(float sigma)
+{
+    if(sigma == sigma_) return;
+    sigma_ = sigma;
+
+    /* Young & van Vliet, "Recursive implementation of the Gaussian filter", 1995 */
+    double q = (sigma >= 2.5) ? 0.98711 * sigma - 0.96330
+                              : 3.97156 - 4.14554 * sqrt(1.0 - 0.26891 * sigma);
+    double q2 = q * q;
+    double q3 = q2 * q;
+
+    double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+    double b1 = 2.44413 * q + 2.85619 * q2 + 1.26661 * q3;
+    double b2 = -(1.4281 * q2 + 1.26661 * q3);
+    double b3 = 0.422205 * q3;
+
+    b1_ = b1 / b0;
+    b2_ = b2 / b0;
+    b3_ = b3 / b0;
+    B_ = 1.0 - (b1_ + b2_ + b3_);
+}
+
+/*
+ * Line l is data[l + k * lines] for k = 0 .. line_length - 1, i.e. the
+ * lines are interleaved and the inner loops run over contiguous memory.
+ * The borders are padded with the first/last value of each line.
+ */
+void CGridDiffusion::filterLines(float* data, uint32_t line_length, uint32_t lines) const
+{
+    const float B = B_, b1 = b1_, b2 = b2_, b3 = b3_;
+
+    /* causal pass, with the padding equal to the first value w[0] = x[0] */
+    for(uint32_t k = 1; k < line_length; k++)
+    {
+        float* __restrict w0 = data + k * lines;
+        const float* __restrict w1 = data + (k - 1) * lines;
+        const float* __restrict w2 = data + ((k >= 2) ? k - 2 : 0) * lines;
+        const float* __restrict w3 = data + ((k >= 3) ? k - 3 : 0) * lines;
+
+        for(uint32_t l = 0; l < lines; l++)
+            w0[l] = B * w0[l] + b1 * w1[l] + b2 * w2[l] + b3 * w3[l];
+    }
+
+    /* anti-causal pass, same for the last value */
+    for(int k = (int) line_length - 2; k >= 0; k--)
+    {
+        float* __restrict y0 = data + k * lines;
+        const float* __restrict y1 = data + std::min(k + 1, (int) line_length - 1) * lines;
+        const float* __restrict y2 = data + std::min(k + 2, (int) line_length - 1) * lines;
+        const float* __restrict y3 = data + std::min(k + 3, (int) line_length - 1) * lines;
+
+        for(uint32_t l = 0; l < lines; l++)
+            y0[l] = B * y0[l] + b1 * y1[l] + b2 * y2[l] + b3 * y3[l];
+    }
+}
+
+void CGridDiffusion::transpose(const float* in, float* out, uint32_t rows, uint32_t cols) const
+{
+    /* in is rows x cols with rows the fast index; done in small blocks to stay in cache */
+    const uint32_t block = 16;
+    for(uint32_t c0 = 0; c0 < cols; c0 += block)
+        for(uint32_t r0 = 0; r0 < rows; r0 += block)
+            for(uint32_t c = c0; c < std::min(c0 + block, cols); c++)
+                for(uint32_t r = r0; r < std::min(r0 + block, rows); r++)
+                    out[c + r * cols] = in[r + c * rows];
+}
+
+void CGridDiffusion::diffuse(std::vector<float>& data, float sigma)
+{
+    ROS_ASSERT(data.size() == height_ * width_);
+    if(!(sigma >= min_sigma_)) return;
+
+    setSigma(sigma);
+
+    /* along y: cell (r, c) is data[r + c * height], the lines are the rows */
+    filterLines(&data[0], width_, height_);
+
+    /* along x on the transposed grid */
+    transpose(&data[0], &transposed_[0], height_, width_);
+    filterLines(&transposed_[0], height_, width_);
+    transpose(&transposed_[0], &data[0], width_, height_);
+}
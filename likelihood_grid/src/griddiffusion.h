@@ -0,0 +1,43 @@
+#ifndef GRIDDIFFUSION_H
+#define GRIDDIFFUSION_H
+
+#include <vector>
+#include "grid.h"
+
+/*
+ * Spreads the evidence of a grid with a Gaussian to model where a person
+ * could have walked since the last update.
+ *
+ * Separable recursive (IIR) Gaussian of Young and van Vliet: a third order
+ * causal pass followed by an anti-causal one along each axis, so the cost
+ * per cell does not depend on sigma. Along each axis all the lines are
+ * filtered together (the innermost loop walks over independent lines, which
+ * the compiler vectorizes); the second axis is done on a transposed copy.
+ */
+
+class CGridDiffusion
+{
+private:
+    uint32_t height_;
+    uint32_t width_;
+    float min_sigma_;               // [cells] below this the grid is left alone
+
+    float sigma_;                   // sigma of the current coefficients
+    float B_;
+    float b1_, b2_, b3_;            // already divided by b0
+
+    std::vector<float> transposed_;
+
+    void setSigma(float sigma);
+    void filterLines(float* data, uint32_t line_length, uint32_t lines) const;
+    void transpose(const float* in, float* out, uint32_t rows, uint32_t cols) const;
+
+public:
+    CGridDiffusion();
+    void init(const MapMetaData_t& map, float min_sigma = 0.5);
+
+    // sigma in cells
+    void diffuse(std::vector<float>& data, float sigma);
+};
+
+#endif // GRIDDIFFUSION_H
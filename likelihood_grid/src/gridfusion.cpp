@@ -0,0 +1,112 @@
+#include "gridfusion.h"
+#include <ros/ros.h>
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+const size_t FUSION_BLOCK = 1024;   // cells, 4 KB of accumulator
+const float MIN_PROBABILITY = 1e-4;
+}
+
+CGridFusion::CGridFusion(FusionMode_t mode, float half_life, float neutral):
+    mode_(mode),
+    half_life_(half_life),
+    neutral_(neutral),
+    size_(0),
+    absent_weight_(0.0)
+{
+    block_.resize(FUSION_BLOCK);
+}
+
+bool CGridFusion::modeFromString(const std::string& name, FusionMode_t& mode)
+{
+    if(name == "linear") mode = FUSION_LINEAR;
+    else if(name == "log_odds") mode = FUSION_LOG_ODDS;
+    else if(name == "product") mode = FUSION_PRODUCT;
+    else return false;
+    return true;
+}
+
+void CGridFusion::clear()
+{
+    inputs_.clear();
+    size_ = 0;
+    absent_weight_ = 0.0;
+}
+
+void CGridFusion::addAbsent(float weight)
+{
+    if(weight > 0.0) absent_weight_ += weight;
+}
+
+void CGridFusion::add(const std::vector<float>& data, float weight, float age)
+{
+    ROS_ASSERT(inputs_.empty() || data.size() == size_);
+    size_ = data.size();
+
+    if(half_life_ > 0.0 && age > 0.0) weight *= pow(0.5, age / half_life_);
+    if(weight <= 0.0 || data.empty()) return;
+
+    Input_t input;
+    input.data = &data[0];
+    input.weight = weight;
+    inputs_.push_back(input);
+}
+
+bool CGridFusion::fuse(std::vector<float>& out)
+{
+    if(inputs_.empty()) return false;
+    out.resize(size_);
+
+    float weight_sum = absent_weight_;
+    for(size_t k = 0; k < inputs_.size(); k++) weight_sum += inputs_[k].weight;
+
+    const float l0 = log(neutral_ / (1.0 - neutral_));
+    const float lo = MIN_PROBABILITY, hi = 1.0 - MIN_PROBABILITY;
+
+    for(size_t begin = 0; begin < size_; begin += FUSION_BLOCK)
+    {
+        const size_t n = std::min(FUSION_BLOCK, size_ - begin);
+        float* __restrict acc = &block_[0];
+        float* __restrict dst = &out[begin];
+
+        std::fill(acc, acc + n, (mode_ == FUSION_LOG_ODDS) ? l0 : 0.0f);
+
+        for(size_t k = 0; k < inputs_.size(); k++)
+        {
+            const float* __restrict src = inputs_[k].data + begin;
+            const float w = inputs_[k].weight;
+
+            switch(mode_)
+            {
+            case FUSION_LINEAR:
+                for(size_t i = 0; i < n; i++) acc[i] += w * src[i];
+                break;
+            case FUSION_LOG_ODDS:
+                for(size_t i = 0; i < n; i++){
+                    float p = std::min(std::max(src[i], lo), hi);
+                    acc[i] += w * (log(p / (1.0f - p)) - l0);
+                }
+                break;
+            case FUSION_PRODUCT:
+                for(size_t i = 0; i < n; i++) acc[i] += w * log(std::max(src[i], lo));
+                break;
+            }
+        }
+
+        switch(mode_)
+        {
+        case FUSION_LINEAR:
+            for(size_t i = 0; i < n; i++) dst[i] = acc[i] / weight_sum;
+            break;
+        case FUSION_LOG_ODDS:
+            for(size_t i = 0; i < n; i++) dst[i] = 1.0f / (1.0f + exp(-acc[i]));
+            break;
+        case FUSION_PRODUCT:
+            for(size_t i = 0; i < n; i++) dst[i] = exp(acc[i]);
+            break;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,63 @@
+#ifndef GRIDFUSION_H
+#define GRIDFUSION_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+/*
+ * Fuses any number of probability grids of the same size into one:
+ *
+ *  FUSION_LINEAR    weighted average                   sum(w p) / sum(w)
+ *  FUSION_LOG_ODDS  independent evidence around p0     l0 + sum(w (logit(p) - l0))
+ *  FUSION_PRODUCT   weighted product                   prod(p^w)
+ *
+ * The weight of an input decays with its age (half life, 0 = no decay) so
+ * a stale sensor fades out instead of counting as much as a fresh one.
+ * Sources without data can be added as absent weight: zero probability in
+ * the linear mode, no evidence in the other two.
+ * All inputs are combined in one pass over the cells, block by block so the
+ * accumulator stays in cache.
+ */
+
+enum FusionMode_t
+{
+    FUSION_LINEAR,
+    FUSION_LOG_ODDS,
+    FUSION_PRODUCT
+};
+
+class CGridFusion
+{
+private:
+    struct Input_t{
+        const float* data;
+        float weight;       // after the staleness decay
+    };
+
+    FusionMode_t mode_;
+    float half_life_;       // [s]
+    float neutral_;         // p0 of the log-odds mode
+    size_t size_;
+    float absent_weight_;
+    std::vector<Input_t> inputs_;
+    std::vector<float> block_;
+
+public:
+    CGridFusion(FusionMode_t mode = FUSION_LINEAR, float half_life = 0.0, float neutral = 0.5);
+
+    static bool modeFromString(const std::string& name, FusionMode_t& mode);
+    void setMode(FusionMode_t mode) {mode_ = mode;}
+    void setHalfLife(float half_life) {half_life_ = half_life;}
+    void setNeutral(float neutral) {neutral_ = neutral;}
+
+    void clear();
+    void add(const std::vector<float>& data, float weight, float age = 0.0);
+    void addAbsent(float weight);
+    size_t inputs() const {return inputs_.size();}
+
+    // false (and out untouched) without inputs
+    bool fuse(std::vector<float>& out);
+};
+
+#endif // GRIDFUSION_H
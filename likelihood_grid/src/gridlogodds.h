@@ -0,0 +1,70 @@
+#ifndef GRIDLOGODDS_H
+#define GRIDLOGODDS_H
+
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ * Fixed-point log-odds for the compact storage mode of CGrid:
+ * l = round(LOG_ODDS_SCALE * log(p / (1 - p))) in an int16_t.
+ */
+
+const float LOG_ODDS_SCALE = 256.0;
+
+inline int16_t toLogOdds(float p)
+{
+    float l = LOG_ODDS_SCALE * log(p / (1.0 - p));
+    l = std::min(std::max(l, -32767.0f), 32767.0f);
+    return (int16_t) floor(l + 0.5);
+}
+
+inline float fromLogOdds(int16_t l)
+{
+    return 1.0 / (1.0 + exp(-l / LOG_ODDS_SCALE));
+}
+
+/*
+ * state[i] = max(state[i] + update[i], lower[i]) with saturating 16-bit
+ * adds, eight cells per instruction with SSE2. Returns the largest state
+ * so that the caller only looks for cells above its upper bound when
+ * there are any.
+ */
+inline int16_t logOddsUpdateKernel(size_t n,
+                                   int16_t* __restrict state,
+                                   const int16_t* __restrict update,
+                                   const int16_t* __restrict lower)
+{
+    size_t i = 0;
+    int16_t max_state = -32768;
+#ifdef __SSE2__
+    __m128i max8 = _mm_set1_epi16(-32768);
+    for(; i + 8 <= n; i += 8)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i*) (state + i));
+        __m128i u = _mm_loadu_si128((const __m128i*) (update + i));
+        __m128i lo = _mm_loadu_si128((const __m128i*) (lower + i));
+        s = _mm_max_epi16(_mm_adds_epi16(s, u), lo);
+        max8 = _mm_max_epi16(max8, s);
+        _mm_storeu_si128((__m128i*) (state + i), s);
+    }
+    int16_t lanes[8];
+    _mm_storeu_si128((__m128i*) lanes, max8);
+    for(int k = 0; k < 8; k++) max_state = std::max(max_state, lanes[k]);
+#endif
+    for(; i < n; i++)
+    {
+        int32_t s = (int32_t) state[i] + update[i];
+        s = std::min(std::max(s, (int32_t) -32768), (int32_t) 32767);
+        s = (s < lower[i]) ? lower[i] : s;
+        state[i] = (int16_t) s;
+        max_state = std::max(max_state, state[i]);
+    }
+    return max_state;
+}
+
+#endif // GRIDLOGODDS_H
@@ -0,0 +1,75 @@
+#ifndef GRIDSPEC_H
+#define GRIDSPEC_H
+
+#include <cstddef>
+#include <stdint.h>
+
+/*
+ * Compile-time geometry of a square robot-centric grid. The resolution is
+ * given in millimetres so that it can be a template argument.
+ */
+
+template <uint32_t SIZE, uint32_t RESOLUTION_MM>
+struct GridSpec
+{
+    static const uint32_t size = SIZE;              // cells per side
+    static const uint32_t cells = SIZE * SIZE;
+    static float resolution() {return RESOLUTION_MM / 1000.0f;}   // [m/cell]
+    static float halfExtent() {return SIZE * RESOLUTION_MM / 2000.0f;}  // [m]
+};
+
+template <uint32_t SIZE, uint32_t RESOLUTION_MM> const uint32_t GridSpec<SIZE, RESOLUTION_MM>::size;
+template <uint32_t SIZE, uint32_t RESOLUTION_MM> const uint32_t GridSpec<SIZE, RESOLUTION_MM>::cells;
+
+// 20 m x 20 m at 0.5 m, used by the single-sensor grid nodes and the human grid node
+typedef GridSpec<40, 500> NodeGridSpec;
+
+
+/*
+ * Per-cell kernels of CGrid. With N > 0 the trip count is a compile-time
+ * constant (the compiler unrolls and vectorizes without a remainder loop);
+ * N = 0 is the dynamic fallback that uses n.
+ */
+
+template <size_t N>
+inline void bayesUpdateKernel(size_t n,
+                              const float* __restrict prior,
+                              const float* __restrict true_likelihood,
+                              const float* __restrict false_likelihood,
+                              const uint8_t* __restrict in_fov,
+                              float free, float unknown, float human,
+                              float* __restrict posterior)
+{
+    const size_t count = (N) ? N : n;
+
+    for(size_t i = 0; i < count; i++)
+    {
+        float t = true_likelihood[i] * prior[i];
+        float p = t / (t + false_likelihood[i] * (1.0f - prior[i]));
+        p = (p > human) ? p * human : p;
+        p = (p < free) ? free : p;
+
+        //PROBABILITY IN unknown AREA CANNOT BE LESS THAN unknown PROBABILITY
+        float lower = (in_fov[i]) ? free : unknown;
+        posterior[i] = (p < lower) ? lower : p;
+    }
+}
+
+template <size_t N>
+inline void likelihoodMixKernel(size_t n,
+                                const float* __restrict detection,
+                                const float* __restrict miss_detection,
+                                float target_detection, float false_detection,
+                                float* __restrict true_likelihood,
+                                float* __restrict false_likelihood)
+{
+    const size_t count = (N) ? N : n;
+
+    for(size_t i = 0; i < count; i++)
+    {
+        true_likelihood[i] = detection[i] * target_detection + miss_detection[i] * (1.0f - target_detection);
+        false_likelihood[i] = detection[i] * false_detection + miss_detection[i] * (1.0f - false_detection);
+    }
+}
+
+#endif // GRIDSPEC_H
@@ -0,0 +1,145 @@
+#include "gridwarp.h"
+#include <cmath>
+
+CGridWarp::CGridWarp():
+    height_(0),
+    width_(0),
+    resolution_(1.0),
+    yaw_quantum_(0.002),
+    max_tables_(16)
+{
+}
+
+void CGridWarp::init(const MapMetaData_t& map, float yaw_quantum, size_t max_tables)
+{
+    ROS_ASSERT(map.height > 1 && map.width > 1 && yaw_quantum > 0.0 && max_tables > 0);
+
+    height_ = map.height;
+    width_ = map.width;
+    resolution_ = map.resolution;
+    yaw_quantum_ = yaw_quantum;
+    max_tables_ = max_tables;
+    tables_.clear();
+
+    size_t size = height_ * width_;
+    index_.resize(size);
+    weight_r_.resize(size);
+    weight_c_.resize(size);
+    source_.resize(size);
+}
+
+void CGridWarp::buildRotationTable(RotationTable_t& table) const
+{
+    float yaw = table.yaw_step * yaw_quantum_;
+    float c = cos(yaw);
+    float s = sin(yaw);
+
+    /* Cell centres relative to the grid centre, in cells */
+    float r0 = (height_ - 1) * 0.5;
+    float c0 = (width_ - 1) * 0.5;
+
+    table.src_r.resize(height_ * width_);
+    table.src_c.resize(height_ * width_);
+
+    for(uint32_t col = 0; col < width_; col++)
+    {
+        float y = col - c0;
+        float* src_r = &table.src_r[col * height_];
+        float* src_c = &table.src_c[col * height_];
+        for(uint32_t r = 0; r < height_; r++)
+        {
+            float x = r - r0;
+            src_r[r] = c * x - s * y + r0;
+            src_c[r] = s * x + c * y + c0;
+        }
+    }
+}
+
+const CGridWarp::RotationTable_t& CGridWarp::rotationTable(int yaw_step)
+{
+    for(std::list<RotationTable_t>::iterator it = tables_.begin(); it != tables_.end(); it++)
+    {
+        if(it->yaw_step != yaw_step) continue;
+        if(it != tables_.begin()) tables_.splice(tables_.begin(), tables_, it);
+        return tables_.front();
+    }
+
+    if(tables_.size() >= max_tables_) tables_.pop_back();
+
+    tables_.push_front(RotationTable_t());
+    tables_.front().yaw_step = yaw_step;
+    buildRotationTable(tables_.front());
+    return tables_.front();
+}
+
+void CGridWarp::warp(std::vector<float>& data, float dx, float dy, float dyaw, float fill)
+{
+    const size_t size = height_ * width_;
+    ROS_ASSERT(data.size() == size);
+
+    int yaw_step = (int) floor(dyaw / yaw_quantum_ + 0.5);
+    if(yaw_step == 0 && fabs(dx) < 1e-4 && fabs(dy) < 1e-4) return;
+
+    const RotationTable_t& table = rotationTable(yaw_step);
+    const float tr = dx / resolution_;
+    const float tc = dy / resolution_;
+    const float max_r = height_ - 1;
+    const float max_c = width_ - 1;
+
+    const float* __restrict rot_r = &table.src_r[0];
+    const float* __restrict rot_c = &table.src_c[0];
+    float* __restrict weight_r = &weight_r_[0];
+    float* __restrict weight_c = &weight_c_[0];
+    int* __restrict index = &index_[0];
+
+    /*
+     * Source coordinates, clamped into the grid so that the gather below
+     * never needs a bounds check; cells whose source falls outside are
+     * marked with a negative index and get the fill value.
+     */
+    for(size_t i = 0; i < size; i++)
+    {
+        float r = rot_r[i] + tr;
+        float c = rot_c[i] + tc;
+        bool inside = (r >= 0.0f) & (r <= max_r) & (c >= 0.0f) & (c <= max_c);
+
+        r = std::min(std::max(r, 0.0f), max_r - 1e-3f);
+        c = std::min(std::max(c, 0.0f), max_c - 1e-3f);
+
+        int ir = (int) r;
+        int ic = (int) c;
+        weight_r[i] = r - ir;
+        weight_c[i] = c - ic;
+        index[i] = inside ? (ir + ic * (int) height_) : -1;
+    }
+
+    const float* __restrict in = &data[0];
+    float* __restrict out = &source_[0];
+
+    for(size_t i = 0; i < size; i++)
+    {
+        int k = std::max(index[i], 0);
+        float wr = weight_r[i];
+        float wc = weight_c[i];
+        float top = in[k] + wr * (in[k + 1] - in[k]);
+        float bottom = in[k + height_] + wr * (in[k + height_ + 1] - in[k + height_]);
+        float value = top + wc * (bottom - top);
+        out[i] = (index[i] < 0) ? fill : value;
+    }
+
+    data.swap(source_);
+}
+
+void CGridWarp::warp(std::vector<float>& data, const Velocity_t& robot_velocity, float dt, float fill)
+{
+    /* Robot displacement over dt expressed in its previous frame */
+    float dyaw = robot_velocity.angular * dt;
+    float half_yaw = dyaw * 0.5;
+    float vx = robot_velocity.lin.x * dt;
+    float vy = robot_velocity.lin.y * dt;
+
+    float dx = cos(half_yaw) * vx - sin(half_yaw) * vy;
+    float dy = sin(half_yaw) * vx + cos(half_yaw) * vy;
+
+    warp(data, dx, dy, dyaw, fill);
+}
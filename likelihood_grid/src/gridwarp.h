@@ -0,0 +1,55 @@
+#ifndef GRIDWARP_H
+#define GRIDWARP_H
+
+#include <vector>
+#include <list>
+#include "grid.h"
+
+/*
+ * Moves a robot-centric grid with the robot: every cell is resampled
+ * (bilinear) from where it was before the robot moved by (dx, dy, dyaw).
+ *
+ * The source of a cell is R(dyaw) * p + t. The rotation part only depends
+ * on dyaw, so it is kept per quantized yaw step in a small table cache
+ * (the robot turns at a handful of rates most of the time) and the
+ * translation is added as a constant offset in cell units.
+ *
+ * The loops work on flat float arrays with no branches so that the
+ * compiler vectorizes them (gridwarp.cpp is built with -O3).
+ */
+
+class CGridWarp
+{
+private:
+    struct RotationTable_t{
+        int yaw_step;
+        std::vector<float> src_r;   // source row (x) of every cell, in cells
+        std::vector<float> src_c;   // source column (y) of every cell, in cells
+    };
+
+    uint32_t height_;
+    uint32_t width_;
+    float resolution_;
+    float yaw_quantum_;             // [rad]
+    size_t max_tables_;
+
+    std::list<RotationTable_t> tables_;   // most recently used first
+
+    std::vector<int> index_;
+    std::vector<float> weight_r_;
+    std::vector<float> weight_c_;
+    std::vector<float> source_;
+
+    const RotationTable_t& rotationTable(int yaw_step);
+    void buildRotationTable(RotationTable_t& table) const;
+
+public:
+    CGridWarp();
+    void init(const MapMetaData_t& map, float yaw_quantum = 0.002, size_t max_tables = 16);
+
+    // Robot motion in its previous frame
+    void warp(std::vector<float>& data, float dx, float dy, float dyaw, float fill);
+    void warp(std::vector<float>& data, const Velocity_t& robot_velocity, float dt, float fill);
+};
+
+#endif // GRIDWARP_H
@@ -7,9 +7,6 @@ int main(int argc, char** argv)
 {
     ros::init(argc, argv, "human_node_grid");
     ros::NodeHandle n;
-    int loop_rate;
-    ros::param::param("~/loop_rate", loop_rate, 5);
-    ros::Rate looprate(loop_rate);
 
 
 //    bool get_leg_grid = true;
@@ -34,18 +31,29 @@ int main(int argc, char** argv)
     CHumanGrid human_grid(n,lw, sw, tw, probability_projection_step);
 
 
-    ros::Subscriber leg_grid_sub = n.subscribe("leg/probability", 10,
-                                               &CHumanGrid::legCallBack,
-                                               &human_grid);
+    ros::Subscriber leg_grid_sub, sound_grid_sub, torso_grid_sub;
 
-    ros::Subscriber sound_grid_sub = n.subscribe("sound/probability", 10,
-                                                 &CHumanGrid::soundCallBack,
-                                                 &human_grid);
+    if(human_grid.mixtureFusion())
+    {
+        // the nodes keep their states as mixtures and send those instead of grids
+        leg_grid_sub = n.subscribe("leg/mixture", 10, &CHumanGrid::legMixtureCallBack, &human_grid);
+        sound_grid_sub = n.subscribe("sound/mixture", 10, &CHumanGrid::soundMixtureCallBack, &human_grid);
+        torso_grid_sub = n.subscribe("torso/mixture", 10, &CHumanGrid::torsoMixtureCallBack, &human_grid);
+    }
+    else
+    {
+        leg_grid_sub = n.subscribe("leg/probability", 10,
+                                   &CHumanGrid::legCallBack,
+                                   &human_grid);
 
+        sound_grid_sub = n.subscribe("sound/probability", 10,
+                                     &CHumanGrid::soundCallBack,
+                                     &human_grid);
 
-    ros::Subscriber torso_grid_sub = n.subscribe("torso/probability", 10,
-                                                 &CHumanGrid::torsoCallBack,
-                                                 &human_grid);
+        torso_grid_sub = n.subscribe("torso/probability", 10,
+                                     &CHumanGrid::torsoCallBack,
+                                     &human_grid);
+    }
 
     ros::Subscriber encoder_sub = n.subscribe("husky/odom", 10,
                                               &CHumanGrid::encoderCallBack, &human_grid);
@@ -53,17 +61,8 @@ int main(int argc, char** argv)
     ros::Subscriber weights_sub = n.subscribe("/weights", 10,
                                               &CHumanGrid::weightsCallBack, &human_grid);
 
-    while(ros::ok())
-    {
-        human_grid.integrateProbabilities();
-
-        if(looprate.cycleTime() > looprate.expectedCycleTime())
-            ROS_ERROR("It is taking too long! %f", looprate.cycleTime().toSec());
-        if(!looprate.sleep())
-            ROS_ERROR("Not enough time left");
-
-        ros::spinOnce();
-    }
+    // The grid is fused whenever one of the sensor grids arrives
+    ros::spin();
 
     return 0;
 }
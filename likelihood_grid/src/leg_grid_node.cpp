@@ -38,6 +38,10 @@ int main(int argc, char** argv)
                                            &CLegGrid::legsCallBack, &leg_grid);
     ros::Subscriber encoder_sub = n.subscribe("husky/odom", 10, &CLegGrid::encoderCallBack, &leg_grid);
 
+    // Callbacks run on their own thread and only hand the messages over to spin()
+    ros::AsyncSpinner spinner(1);
+    spinner.start();
+
     while (ros::ok())
     {
         leg_grid.spin();
@@ -46,8 +50,6 @@ int main(int argc, char** argv)
             ROS_ERROR("It is taking too long! %f", looprate.cycleTime().toSec());
         if(!looprate.sleep())
             ROS_ERROR("Not enough time left");
-
-        ros::spinOnce();
     }
 
     return 0;
@@ -8,7 +8,15 @@ CLikelihoodGrid::CLikelihoodGrid()
 
 CLikelihoodGrid::CLikelihoodGrid(ros::NodeHandle _n, tf::TransformListener *_tf_listener):
     n_(_n),
-    tf_listener_(_tf_listener)
+    tf_listener_(_tf_listener),
+    leg_world_grid_(NULL),
+    torso_world_grid_(NULL),
+    sound_world_grid_(NULL),
+    leg_multires_grid_(NULL),
+    torso_multires_grid_(NULL),
+    sound_multires_grid_(NULL),
+    human_multires_grid_(NULL),
+    human_particle_filter_(NULL)
 {
     ROS_INFO("Constructing an instace of LikelihoodGridInterface.");
     init();
@@ -42,12 +50,61 @@ void CLikelihoodGrid::init()
 
     ros::param::param("~/LikelihoodGrid/probability_projection_step", PROJECTION_ANGLE_STEP, 1);
 
+    ros::param::param("~/delta_updates_enable", DELTA_UPDATES_ENABLE_, false);
+    ros::param::param("~/delta_keyframe_period", DELTA_KEYFRAME_PERIOD_, 10);
+    ros::param::param("~/delta_tile_size", DELTA_TILE_SIZE_, 8);
+
+    ros::param::param("~/world_fixed_grid_enable", WORLD_FIXED_GRID_ENABLE_, false);
+    if(WORLD_FIXED_GRID_ENABLE_ && !MOTION_MODEL_ENABLE_){
+        ROS_WARN("world_fixed_grid_enable needs odometry, enable motion_model_enable. Disabling.");
+        WORLD_FIXED_GRID_ENABLE_ = false;
+    }
+    robot_pose_.x = robot_pose_.y = robot_pose_.yaw = 0.0;
+
+    ros::param::param("~/prior_warp_enable", PRIOR_WARP_ENABLE_, false);
+    PRIOR_WARP_ENABLE_ = PRIOR_WARP_ENABLE_ && MOTION_MODEL_ENABLE_ && !WORLD_FIXED_GRID_ENABLE_;
+
+    ros::param::param("~/prior_diffusion_enable", PRIOR_DIFFUSION_ENABLE_, false);
+    ros::param::param("~/LikelihoodGrid/human_max_speed", HUMAN_MAX_SPEED_, (float) 1.5);
+
+    ros::param::param("~/log_odds_storage_enable", LOG_ODDS_STORAGE_ENABLE_, false);
+    if(LOG_ODDS_STORAGE_ENABLE_ && (WORLD_FIXED_GRID_ENABLE_ || PRIOR_WARP_ENABLE_ || PRIOR_DIFFUSION_ENABLE_)){
+        ROS_WARN("The world-fixed grid, prior warp and prior diffusion work on the float prior, disabling them for log_odds_storage_enable.");
+        WORLD_FIXED_GRID_ENABLE_ = PRIOR_WARP_ENABLE_ = PRIOR_DIFFUSION_ENABLE_ = false;
+    }
+
+    std::string fusion_mode;
+    float fusion_half_life;
+    FusionMode_t mode;
+    ros::param::param("~/fusion_mode", fusion_mode, std::string("linear"));
+    ros::param::param("~/fusion_staleness_half_life", fusion_half_life, (float) 0.0);
+    if(!CGridFusion::modeFromString(fusion_mode, mode)){
+        ROS_WARN("Unknown fusion_mode \"%s\" (linear, log_odds, product), using linear.", fusion_mode.c_str());
+        mode = FUSION_LINEAR;
+    }
+    human_fusion_.setMode(mode);
+    human_fusion_.setHalfLife(fusion_half_life);
+    human_fusion_.setNeutral(CELL_PROBABILITY_.unknown);
+
+    ros::param::param("~/LikelihoodGrid/leg_fusion_weight", LEG_FUSION_WEIGHT_, (float) 1.0);
+    ros::param::param("~/LikelihoodGrid/torso_fusion_weight", TORSO_FUSION_WEIGHT_, (float) 1.0);
+    ros::param::param("~/LikelihoodGrid/sound_fusion_weight", SOUND_FUSION_WEIGHT_, (float) 1.0);
+    ros::param::param("~/LikelihoodGrid/periodic_fusion_weight", PERIODIC_FUSION_WEIGHT_, (float) 1.0);
+
+    ros::param::param("~/multires/enable", MULTIRES_ENABLE_, false);
+    ros::param::param("~/multires/base_resolution", MULTIRES_BASE_RESOLUTION_, (float) 0.05);
+    ros::param::param("~/multires/cells_per_side", MULTIRES_CELLS_PER_SIDE_, 64);
+    ros::param::param("~/multires/levels", MULTIRES_LEVELS_, 5);
+
+    ros::param::param("~/particle_filter/enable", PARTICLE_FILTER_ENABLE_, false);
+
 
     number_of_sensors_ = (LEG_DETECTION_ENABLE_) + (TORSO_DETECTION_ENABLE_)
             + (SOUND_DETECTION_ENABLE_) + (PERIODIC_GESTURE_DETECTION_ENABLE_);
     ROS_INFO("number_of_sensors is set to %u",number_of_sensors_);
 
     encoder_last_time_ = ros::Time::now();
+    last_leg_time_ = last_torso_time_ = last_sound_time_ = last_periodic_time_ = encoder_last_time_;
 
     if(PERIODIC_GESTURE_DETECTION_ENABLE_){
         FOV_.range.max = 30.0;
@@ -78,13 +135,16 @@ void CLikelihoodGrid::init()
         ros::param::param("~/LikelihoodGrid/leg_unknown_cell_probability",LEG_CELL_PROBABILITY_.unknown, (float) 0.25);
 
         initLegGrid(LEG_DETECTOR_FOV);
+        if(WORLD_FIXED_GRID_ENABLE_) leg_world_grid_ = initWorldGrid(LEG_CELL_PROBABILITY_.unknown);
 
         ros::param::param("~/LikelihoodGrid/leg_range_stdev",leg_grid_->stdev.range, (float) 0.1);
         ros::param::param("~/LikelihoodGrid/leg_angle_stdev",leg_grid_->stdev.angle, (float) 0.1);
 
         leg_grid_->projection_angle_step = PROJECTION_ANGLE_STEP;
+        if(MULTIRES_ENABLE_) leg_multires_grid_ = initMultiResGrid(leg_grid_);
+        leg_grid_->setLogOddsStorage(LOG_ODDS_STORAGE_ENABLE_);
 
-        legs_grid_pub_ = n_.advertise<nav_msgs::OccupancyGrid>("leg/occupancy_grid",10);
+        legs_grid_pub_.init(n_, "leg/occupancy_grid", DELTA_UPDATES_ENABLE_, DELTA_KEYFRAME_PERIOD_, DELTA_TILE_SIZE_);
         predicted_leg_base_pub_ = n_.advertise<geometry_msgs::PoseArray>("predicted_legs",10);
         last_leg_base_pub_ = n_.advertise<geometry_msgs::PoseArray>("last_legs",10);
         current_leg_base_pub_ = n_.advertise<geometry_msgs::PoseArray>("legs_basefootprint",10);
@@ -104,12 +164,15 @@ void CLikelihoodGrid::init()
         ros::param::param("~/LikelihoodGrid/torso_unknown_cell_probability",TORSO_CELL_PROBABILITY_.unknown, (float)0.25);
 
         initTorsoGrid(TORSO_DETECTOR_FOV);
+        if(WORLD_FIXED_GRID_ENABLE_) torso_world_grid_ = initWorldGrid(TORSO_CELL_PROBABILITY_.unknown);
 
         ros::param::param("~/LikelihoodGrid/torso_range_stdev",torso_grid_->stdev.range, (float)0.2);
         ros::param::param("~/LikelihoodGrid/torso_angle_stdev",torso_grid_->stdev.angle, (float)1.0);
         torso_grid_->projection_angle_step = PROJECTION_ANGLE_STEP;
+        if(MULTIRES_ENABLE_) torso_multires_grid_ = initMultiResGrid(torso_grid_);
+        torso_grid_->setLogOddsStorage(LOG_ODDS_STORAGE_ENABLE_);
 
-        torso_grid_pub_ = n_.advertise<nav_msgs::OccupancyGrid>("torso/occupancy_grid",10);
+        torso_grid_pub_.init(n_, "torso/occupancy_grid", DELTA_UPDATES_ENABLE_, DELTA_KEYFRAME_PERIOD_, DELTA_TILE_SIZE_);
     }
 
     if(SOUND_DETECTION_ENABLE_){
@@ -126,18 +189,34 @@ void CLikelihoodGrid::init()
         ros::param::param("~/LikelihoodGrid/sound_unknown_cell_probability",SOUND_CELL_PROBABILITY_.unknown, (float)0.25);
 
         initSoundGrid(SOUND_DETECTOR_FOV);
+        if(WORLD_FIXED_GRID_ENABLE_) sound_world_grid_ = initWorldGrid(SOUND_CELL_PROBABILITY_.unknown);
 
         ros::param::param("~/LikelihoodGrid/sound_range_stdev",sound_grid_->stdev.range, (float) 0.5);
         ros::param::param("~/LikelihoodGrid/sound_angle_stdev",sound_grid_->stdev.angle, (float) 5.0);
         sound_grid_->projection_angle_step = PROJECTION_ANGLE_STEP;
-        sound_grid_pub_ = n_.advertise<nav_msgs::OccupancyGrid>("sound/occupancy_grid",10);
+        if(MULTIRES_ENABLE_) sound_multires_grid_ = initMultiResGrid(sound_grid_);
+        sound_grid_->setLogOddsStorage(LOG_ODDS_STORAGE_ENABLE_);
+        sound_grid_pub_.init(n_, "sound/occupancy_grid", DELTA_UPDATES_ENABLE_, DELTA_KEYFRAME_PERIOD_, DELTA_TILE_SIZE_);
     }
 
     initHumanGrid(FOV_);
     human_grid_->projection_angle_step = PROJECTION_ANGLE_STEP;
-    human_grid_pub_ = n_.advertise<nav_msgs::OccupancyGrid>("human/occupancy_grid",10);
+    if(PRIOR_WARP_ENABLE_) prior_warp_.init(human_grid_->map);
+    if(PRIOR_DIFFUSION_ENABLE_) prior_diffusion_.init(human_grid_->map);
+    if(MULTIRES_ENABLE_){
+        human_multires_grid_ = initMultiResGrid(human_grid_);
+        multires_grid_pub_ = n_.advertise<nav_msgs::OccupancyGrid>("human/multires_occupancy_grid", 10);
+        multires_local_maxima_pub_ = n_.advertise<geometry_msgs::PoseArray>("multires_local_maxima", 10);
+    }
+    if(PARTICLE_FILTER_ENABLE_){
+        initParticleFilter();
+        particle_grid_pub_ = n_.advertise<nav_msgs::OccupancyGrid>("human/particle_occupancy_grid", 10);
+        particle_projection_pub_ = n_.advertise<geometry_msgs::PoseArray>("human/particle_projection", 10);
+    }
+    human_grid_pub_.init(n_, "human/occupancy_grid", DELTA_UPDATES_ENABLE_, DELTA_KEYFRAME_PERIOD_, DELTA_TILE_SIZE_);
     local_maxima_pub_ = n_.advertise<geometry_msgs::PoseArray>("local_maxima",10);
     max_prob_pub_ = n_.advertise<geometry_msgs::PointStamped>("maximum_probability",10);
+    tracks_pub_ = n_.advertise<likelihood_grid::HumanTrackArray>("human/tracks",10);
 
     try
     {
@@ -291,8 +370,89 @@ void CLikelihoodGrid::initHumanGrid(SensorFOV_t _FOV)
     }
 }
 
+void CLikelihoodGrid::initParticleFilter()
+{
+    int particles_per_person, min_particles, max_particles, threads;
+    float birth_ratio;
+    ros::param::param("~/particle_filter/particles_per_person", particles_per_person, 500);
+    ros::param::param("~/particle_filter/min_particles", min_particles, 1000);
+    ros::param::param("~/particle_filter/max_particles", max_particles, 20000);
+    ros::param::param("~/particle_filter/birth_ratio", birth_ratio, (float) 0.1);
+    ros::param::param("~/particle_filter/threads", threads, 1);
+
+    try
+    {
+        human_particle_filter_ = new CParticleFilter(FOV_, CELL_PROBABILITY_,
+                                                     particles_per_person, min_particles, max_particles,
+                                                     TARGET_DETETION_PROBABILITY_, FALSE_POSITIVE_PROBABILITY_,
+                                                     birth_ratio, HUMAN_MAX_SPEED_, HUMAN_MAX_SPEED_, threads);
+    }
+    catch (std::bad_alloc& ba)
+    {
+        std::cerr << "In new particleFilter: bad_alloc caught: " << ba.what() << '\n';
+    }
+    particle_filter_last_time_ = ros::Time::now();
+}
+
+CScrollingGrid* CLikelihoodGrid::initWorldGrid(float fill)
+{
+    CScrollingGrid* world_grid = NULL;
+    try
+    {
+        world_grid = new CScrollingGrid(MAP_SIZE_, MAP_RESOLUTION_, fill);
+    }
+    catch (std::bad_alloc& ba)
+    {
+        std::cerr << "In new worldGrid: bad_alloc caught: " << ba.what() << '\n';
+    }
+    return world_grid;
+}
+
+CMultiResGrid* CLikelihoodGrid::initMultiResGrid(const CGrid* grid)
+{
+    CMultiResGrid* multires_grid = NULL;
+    try
+    {
+        multires_grid = new CMultiResGrid(MULTIRES_BASE_RESOLUTION_, MULTIRES_CELLS_PER_SIDE_, MULTIRES_LEVELS_,
+                                          grid->sensor_fov, grid->cell_probability,
+                                          TARGET_DETETION_PROBABILITY_, FALSE_POSITIVE_PROBABILITY_);
+        multires_grid->stdev = grid->stdev;
+    }
+    catch (std::bad_alloc& ba)
+    {
+        std::cerr << "In new multiResGrid: bad_alloc caught: " << ba.what() << '\n';
+    }
+    return multires_grid;
+}
+
+/*
+ * The callbacks only hand the messages over to spin(), which may run on
+ * another thread than the spinner; they are processed at the start of the
+ * next cycle.
+ */
 void CLikelihoodGrid::syncCallBack(const geometry_msgs::PoseArrayConstPtr& leg_msg_crtsn,
                                           const nav_msgs::OdometryConstPtr& encoder_msg)
+{
+    sync_buffer_.write(std::make_pair(leg_msg_crtsn, encoder_msg));
+}
+
+void CLikelihoodGrid::torsoCallBack(const autonomy_human::raw_detectionsConstPtr &torso_msg)
+{
+    torso_buffer_.write(torso_msg);
+}
+
+void CLikelihoodGrid::soundCallBack(const hark_msgs::HarkSourceConstPtr &sound_msg)
+{
+    sound_buffer_.write(sound_msg);
+}
+
+void CLikelihoodGrid::periodicCallBack(const autonomy_human::raw_detectionsConstPtr &periodic_msg)
+{
+    periodic_buffer_.write(periodic_msg);
+}
+
+void CLikelihoodGrid::processSync(const geometry_msgs::PoseArrayConstPtr& leg_msg_crtsn,
+                                  const nav_msgs::OdometryConstPtr& encoder_msg)
 {
 //    ----------   ENCODER CALLBACK   ----------
     if(MOTION_MODEL_ENABLE_){
@@ -302,12 +462,17 @@ void CLikelihoodGrid::syncCallBack(const geometry_msgs::PoseArrayConstPtr& leg_m
         robot_velocity_.angular = encoder_msg->twist.twist.angular.z;
         encoder_diff_time_ = ros::Time::now() - encoder_last_time_;
         encoder_last_time_ = ros::Time::now();
+
+        robot_pose_.x = encoder_msg->pose.pose.position.x;
+        robot_pose_.y = encoder_msg->pose.pose.position.y;
+        robot_pose_.yaw = tf::getYaw(encoder_msg->pose.pose.orientation);
     }
 
 //    ----------   LEG DETECTION CALLBACK   ----------
     if(LEG_DETECTION_ENABLE_){
 
         leg_grid_->crtsn_array.current.poses.clear();
+        last_leg_time_ = ros::Time::now();
 
         if(!transformToBase(leg_msg_crtsn, leg_grid_->crtsn_array.current)){
             ROS_WARN("Can not transform from laser to base_footprint");
@@ -320,23 +485,29 @@ void CLikelihoodGrid::syncCallBack(const geometry_msgs::PoseArrayConstPtr& leg_m
     }
 }
 
-void CLikelihoodGrid::torsoCallBack(const autonomy_human::raw_detectionsConstPtr &torso_msg)
+void CLikelihoodGrid::processTorso(const autonomy_human::raw_detectionsConstPtr &torso_msg)
 {
-    if(TORSO_DETECTION_ENABLE_)
+    if(TORSO_DETECTION_ENABLE_){
         torso_grid_->getPose(torso_msg);
+        last_torso_time_ = ros::Time::now();
+    }
 }
 
 
-void CLikelihoodGrid::soundCallBack(const hark_msgs::HarkSourceConstPtr &sound_msg)
+void CLikelihoodGrid::processSound(const hark_msgs::HarkSourceConstPtr &sound_msg)
 {
-    if(SOUND_DETECTION_ENABLE_)
+    if(SOUND_DETECTION_ENABLE_){
         sound_grid_->getPose(sound_msg);
+        last_sound_time_ = ros::Time::now();
+    }
 }
 
-void CLikelihoodGrid::periodicCallBack(const autonomy_human::raw_detectionsConstPtr &periodic_msg)
+void CLikelihoodGrid::processPeriodic(const autonomy_human::raw_detectionsConstPtr &periodic_msg)
 {
-    if(PERIODIC_GESTURE_DETECTION_ENABLE_)
+    if(PERIODIC_GESTURE_DETECTION_ENABLE_){
         periodic_grid_->getPose(periodic_msg);
+        last_periodic_time_ = ros::Time::now();
+    }
 }
 
 void CLikelihoodGrid::occupancyGrid(CGrid* grid, nav_msgs::OccupancyGrid *occupancy_grid)
@@ -358,8 +529,132 @@ void CLikelihoodGrid::occupancyGrid(CGrid* grid, nav_msgs::OccupancyGrid *occupa
 }
 
 
+/*
+ * Runs the filter of a robot-centric grid on top of its world-fixed copy:
+ * the prior is read back from the odom frame at the current robot pose, so
+ * the accumulated evidence stays where it was observed while the robot moves.
+ * Without a world grid the prior can instead be warped by the robot motion
+ * since the last cycle. Either way it is then diffused for the motion of the
+ * people themselves.
+ */
+void CLikelihoodGrid::bayesOccupancyFilter(CGrid* grid, CScrollingGrid* world_grid)
+{
+    if(world_grid){
+        world_grid->scrollTo(robot_pose_.x, robot_pose_.y);
+        world_grid->sampleRobotView(robot_pose_, grid->map, grid->prior);
+    }else if(PRIOR_WARP_ENABLE_){
+        prior_warp_.warp(grid->prior, robot_velocity_, grid->diff_time.toSec(),
+                         grid->cell_probability.unknown);
+    }
+
+    if(PRIOR_DIFFUSION_ENABLE_){
+        // sigma in cells, from how far a person can walk since the last update of this sensor
+        float sigma = HUMAN_MAX_SPEED_ * grid->diff_time.toSec() / grid->map.resolution;
+        prior_diffusion_.diffuse(grid->prior, sigma);
+    }
+
+    grid->bayesOccupancyFilter();
+
+    if(world_grid) world_grid->storeRobotView(robot_pose_, grid->map, grid->posterior);
+}
+
+/*
+ * Same filter on the multi-resolution grids, using the detections the
+ * uniform grids just consumed. The fused grid is only resampled to an
+ * OccupancyGrid when somebody listens.
+ */
+void CLikelihoodGrid::spinMultiRes()
+{
+    ros::Time now = ros::Time::now();
+    human_fusion_.clear();
+
+    if(LEG_DETECTION_ENABLE_){
+        leg_multires_grid_->bayesOccupancyFilter(leg_grid_->polar_array.predicted, leg_grid_->polar_array.current);
+        human_fusion_.add(leg_multires_grid_->posterior, LEG_FUSION_WEIGHT_, (now - last_leg_time_).toSec());
+    }
+    if(TORSO_DETECTION_ENABLE_){
+        torso_multires_grid_->bayesOccupancyFilter(torso_grid_->polar_array.predicted, torso_grid_->polar_array.current);
+        human_fusion_.add(torso_multires_grid_->posterior, TORSO_FUSION_WEIGHT_, (now - last_torso_time_).toSec());
+    }
+    if(SOUND_DETECTION_ENABLE_){
+        sound_multires_grid_->bayesOccupancyFilter(sound_grid_->polar_array.predicted, sound_grid_->polar_array.current);
+        human_fusion_.add(sound_multires_grid_->posterior, SOUND_FUSION_WEIGHT_, (now - last_sound_time_).toSec());
+    }
+
+    human_fusion_.fuse(human_multires_grid_->posterior);
+
+    human_multires_grid_->localMaxima(human_multires_grid_->cell_probability.unknown, 0.5, multires_local_maxima_);
+    multires_local_maxima_.header.frame_id = "base_footprint";
+    multires_local_maxima_.header.stamp = ros::Time::now();
+    multires_local_maxima_pub_.publish(multires_local_maxima_);
+
+    if(multires_grid_pub_.getNumSubscribers()){
+        human_multires_grid_->toOccupancyGrid(MAP_RESOLUTION_, MAP_SIZE_, multires_occupancy_grid_);
+        multires_occupancy_grid_.header.stamp = ros::Time::now();
+        multires_grid_pub_.publish(multires_occupancy_grid_);
+    }
+}
+
+/*
+ * Runs the particle filter on the detections that arrived since its last
+ * update; the grid and the projection are only rendered for subscribers.
+ */
+void CLikelihoodGrid::spinParticleFilter()
+{
+    ros::Time now = ros::Time::now();
+    human_particle_filter_->predict(robot_velocity_, (now - last_time_).toSec());
+
+    if(LEG_DETECTION_ENABLE_ && last_leg_time_ > particle_filter_last_time_)
+        human_particle_filter_->update(leg_grid_->polar_array.current, leg_grid_->stdev, leg_grid_->sensor_fov);
+    if(TORSO_DETECTION_ENABLE_ && last_torso_time_ > particle_filter_last_time_)
+        human_particle_filter_->update(torso_grid_->polar_array.current, torso_grid_->stdev, torso_grid_->sensor_fov);
+    if(SOUND_DETECTION_ENABLE_ && last_sound_time_ > particle_filter_last_time_)
+        human_particle_filter_->update(sound_grid_->polar_array.current, sound_grid_->stdev, sound_grid_->sensor_fov);
+
+    human_particle_filter_->resample();
+    particle_filter_last_time_ = now;
+
+    if(particle_grid_pub_.getNumSubscribers()){
+        human_particle_filter_->rasterise(human_grid_->map, particle_grid_);
+        particle_occupancy_grid_.info = human_grid_->occupancy_grid.info;
+        particle_occupancy_grid_.header.frame_id = "base_footprint";
+        particle_occupancy_grid_.header.stamp = now;
+        particle_occupancy_grid_.data.resize(particle_grid_.size());
+        for(size_t i = 0; i < particle_grid_.size(); i++)
+            particle_occupancy_grid_.data[i] = (int8_t) (100 * particle_grid_[i]);
+        particle_grid_pub_.publish(particle_occupancy_grid_);
+    }
+    if(particle_projection_pub_.getNumSubscribers()){
+        human_particle_filter_->project(PROJECTION_ANGLE_STEP, particle_projection_);
+        particle_projection_pub_.publish(particle_projection_);
+    }
+}
+
+void CLikelihoodGrid::fuseHumanGrid()
+{
+    ros::Time now = ros::Time::now();
+    human_fusion_.clear();
+
+    if(LEG_DETECTION_ENABLE_)
+        human_fusion_.add(leg_grid_->posterior, LEG_FUSION_WEIGHT_, (now - last_leg_time_).toSec());
+    if(TORSO_DETECTION_ENABLE_)
+        human_fusion_.add(torso_grid_->posterior, TORSO_FUSION_WEIGHT_, (now - last_torso_time_).toSec());
+    if(SOUND_DETECTION_ENABLE_)
+        human_fusion_.add(sound_grid_->posterior, SOUND_FUSION_WEIGHT_, (now - last_sound_time_).toSec());
+    if(PERIODIC_GESTURE_DETECTION_ENABLE_)
+        human_fusion_.add(periodic_grid_->posterior, PERIODIC_FUSION_WEIGHT_, (now - last_periodic_time_).toSec());
+
+    if(!human_fusion_.fuse(human_grid_->posterior))
+        human_grid_->posterior.assign(human_grid_->grid_size, CELL_PROBABILITY_.unknown);
+}
+
 void CLikelihoodGrid::spin()
 {
+    if(sync_buffer_.update()) processSync(sync_buffer_.readBuffer().first, sync_buffer_.readBuffer().second);
+    if(torso_buffer_.update()) processTorso(torso_buffer_.readBuffer());
+    if(sound_buffer_.update()) processSound(sound_buffer_.readBuffer());
+    if(periodic_buffer_.update()) processPeriodic(periodic_buffer_.readBuffer());
+
     if(LEG_DETECTION_ENABLE_){
         leg_grid_->diff_time = ros::Time::now() - last_time_;
 
@@ -376,7 +671,7 @@ void CLikelihoodGrid::spin()
         last_leg_base_pub_.publish(leg_grid_->crtsn_array.past);
         /* ******* */
 
-        leg_grid_->bayesOccupancyFilter();
+        bayesOccupancyFilter(leg_grid_, leg_world_grid_);
 
 
         //PUBLISH LEG OCCUPANCY GRID
@@ -390,7 +685,7 @@ void CLikelihoodGrid::spin()
     {
         torso_grid_->diff_time = ros::Time::now() - last_time_;;
         torso_grid_->predict(robot_velocity_);
-        torso_grid_->bayesOccupancyFilter();
+        bayesOccupancyFilter(torso_grid_, torso_world_grid_);
 
         //PUBLISH TORSO OCCUPANCY GRID
         occupancyGrid(torso_grid_, &torso_occupancy_grid_);
@@ -403,7 +698,7 @@ void CLikelihoodGrid::spin()
     {
         sound_grid_->diff_time = ros::Time::now() - last_time_;;
         sound_grid_->predict(robot_velocity_);
-        sound_grid_->bayesOccupancyFilter();
+        bayesOccupancyFilter(sound_grid_, sound_world_grid_);
 
         //PUBLISH SOUND OCCUPANCY GRID
         occupancyGrid(sound_grid_, &sound_occupancy_grid_);
@@ -414,11 +709,23 @@ void CLikelihoodGrid::spin()
 
     //---------------------------------------------
 
+    if(PERIODIC_GESTURE_DETECTION_ENABLE_)
+    {
+        periodic_grid_->diff_time = ros::Time::now() - last_time_;
+        periodic_grid_->predict(robot_velocity_);
+        bayesOccupancyFilter(periodic_grid_, NULL);
+
+        //PUBLISH PERIODIC GESTURE OCCUPANCY GRID
+        occupancyGrid(periodic_grid_, &periodic_occupancy_grid_);
+        periodic_occupancy_grid_.header.stamp = ros::Time::now();
+        periodic_grid_pub_.publish(periodic_occupancy_grid_);
+    }
+
+    //---------------------------------------------
+
     human_grid_->diff_time = ros::Time::now() - last_time_;
 
-    //TODO: Should not depend on three vectors
-    human_grid_->fuse(sound_grid_->posterior, leg_grid_->posterior, torso_grid_->posterior,
-                      FUSE_MULTIPLY_);
+    fuseHumanGrid();
     human_grid_->predict(robot_velocity_); // TODO: FIX THIS
 
     //PUBLISH LOCAL MAXIMA
@@ -431,13 +738,52 @@ void CLikelihoodGrid::spin()
     maximum_probability_.header.stamp = ros::Time::now();
     max_prob_pub_.publish(maximum_probability_);
 
+    //PUBLISH TRACKED PEOPLE
+    publishTracks();
+
     //PUBLISH INTEGRATED OCCUPANCY GRID
     occupancyGrid(human_grid_, &human_occupancy_grid_);
     human_occupancy_grid_.header.stamp = ros::Time::now();
     human_grid_pub_.publish(human_occupancy_grid_);
+
+    if(MULTIRES_ENABLE_) spinMultiRes();
+    if(PARTICLE_FILTER_ENABLE_) spinParticleFilter();
     last_time_ = ros::Time::now();
 }
 
+void CLikelihoodGrid::publishTracks()
+{
+    if(tracks_pub_.getNumSubscribers() == 0) return;
+
+    /* Only the confirmed tracks, a few dozen bytes per person */
+    const std::vector<HumanTrack_t>& tracks = human_grid_->tracker().tracks();
+    tracks_.tracks.clear();
+    likelihood_grid::HumanTrack t;
+    for(size_t i = 0; i < tracks.size(); i++)
+    {
+        if(!tracks.at(i).confirmed) continue;
+        const float* s = tracks.at(i).state;
+        const float* P = tracks.at(i).cov;
+        t.id = tracks.at(i).id;
+        t.x = s[0];
+        t.y = s[1];
+        t.vx = s[2];
+        t.vy = s[3];
+        t.position_covariance[0] = P[0];
+        t.position_covariance[1] = P[1];
+        t.position_covariance[2] = P[5];
+        t.velocity_covariance[0] = P[10];
+        t.velocity_covariance[1] = P[11];
+        t.velocity_covariance[2] = P[15];
+        t.probability = tracks.at(i).probability;
+        tracks_.tracks.push_back(t);
+    }
+
+    tracks_.header.frame_id = "base_footprint";
+    tracks_.header.stamp = ros::Time::now();
+    tracks_pub_.publish(tracks_);
+}
+
 CLikelihoodGrid::~CLikelihoodGrid()
 {
     ROS_INFO("Deconstructing the constructed LikelihoodGridInterface.");
@@ -446,5 +792,13 @@ CLikelihoodGrid::~CLikelihoodGrid()
     if(SOUND_DETECTION_ENABLE_) delete sound_grid_;
     if(PERIODIC_GESTURE_DETECTION_ENABLE_) delete periodic_grid_;
     delete human_grid_;
+    delete leg_world_grid_;
+    delete torso_world_grid_;
+    delete sound_world_grid_;
+    delete leg_multires_grid_;
+    delete torso_multires_grid_;
+    delete sound_multires_grid_;
+    delete human_multires_grid_;
+    delete human_particle_filter_;
     delete tf_listener_;
 }
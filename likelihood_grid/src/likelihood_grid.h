@@ -14,7 +14,16 @@
 #include <nav_msgs/Odometry.h>
 #include <geometry_msgs/TwistWithCovariance.h>
 #include <geometry_msgs/Twist.h>
+#include <likelihood_grid/HumanTrackArray.h>
 #include "grid.h"
+#include "griddelta.h"
+#include "scrollgrid.h"
+#include "gridwarp.h"
+#include "griddiffusion.h"
+#include "multiresgrid.h"
+#include "particlefilter.h"
+#include "gridfusion.h"
+#include "triplebuffer.h"
 
 
 class CLikelihoodGrid
@@ -27,7 +36,7 @@ private:
     ros::Publisher predicted_leg_base_pub_;
     ros::Publisher last_leg_base_pub_;
     ros::Publisher current_leg_base_pub_;
-    ros::Publisher legs_grid_pub_;
+    CGridDeltaPublisher legs_grid_pub_;
     CGrid* leg_grid_;
     ros::Time last_leg_time_;
     ros::Duration leg_diff_time_;
@@ -39,7 +48,7 @@ private:
 
 
     // person
-    ros::Publisher torso_grid_pub_;
+    CGridDeltaPublisher torso_grid_pub_;
     std::string torso_frame_id_;
     CGrid* torso_grid_;
     ros::Time last_torso_time_;
@@ -48,7 +57,7 @@ private:
     nav_msgs::OccupancyGrid torso_occupancy_grid_;
 
     // Sound
-    ros::Publisher sound_grid_pub_;
+    CGridDeltaPublisher sound_grid_pub_;
     std::string sound_frame_id_;
     CGrid* sound_grid_;
     ros::Time last_sound_time_;
@@ -68,15 +77,21 @@ private:
     nav_msgs::OccupancyGrid periodic_occupancy_grid_;
 
     // Human
-    ros::Publisher human_grid_pub_;
+    CGridDeltaPublisher human_grid_pub_;
     ros::Publisher local_maxima_pub_;
     ros::Publisher max_prob_pub_;
+    ros::Publisher tracks_pub_;
     std::string human_frame_id_;
     CGrid* human_grid_;
     nav_msgs::OccupancyGrid human_occupancy_grid_;
-    bool FUSE_MULTIPLY_;
+    CGridFusion human_fusion_;
+    float LEG_FUSION_WEIGHT_;
+    float TORSO_FUSION_WEIGHT_;
+    float SOUND_FUSION_WEIGHT_;
+    float PERIODIC_FUSION_WEIGHT_;
     geometry_msgs::PoseArray local_maxima_;
     geometry_msgs::PointStamped maximum_probability_;
+    likelihood_grid::HumanTrackArray tracks_;
     geometry_msgs::PointStamped maximum_periodic_probability_;
 
 
@@ -110,7 +125,65 @@ private:
 
     int PROJECTION_ANGLE_STEP;
 
+    bool DELTA_UPDATES_ENABLE_;
+    int DELTA_KEYFRAME_PERIOD_;
+    int DELTA_TILE_SIZE_;
+
+    // World-fixed (odom) copies of the sensor posteriors
+    bool WORLD_FIXED_GRID_ENABLE_;
+    Pose2D_t robot_pose_;
+    CScrollingGrid* leg_world_grid_;
+    CScrollingGrid* torso_world_grid_;
+    CScrollingGrid* sound_world_grid_;
+
+    // Motion compensation of the robot-centric priors
+    bool PRIOR_WARP_ENABLE_;
+    CGridWarp prior_warp_;
+
+    // Process noise of the priors: how far a person may have walked
+    bool PRIOR_DIFFUSION_ENABLE_;
+    float HUMAN_MAX_SPEED_;
+    CGridDiffusion prior_diffusion_;
+
+    // Sensor grids keep fixed-point log-odds instead of float vectors
+    bool LOG_ODDS_STORAGE_ENABLE_;
+
+    // Multi-resolution grids fed with the same detections
+    bool MULTIRES_ENABLE_;
+    float MULTIRES_BASE_RESOLUTION_;
+    int MULTIRES_CELLS_PER_SIDE_;
+    int MULTIRES_LEVELS_;
+    CMultiResGrid* leg_multires_grid_;
+    CMultiResGrid* torso_multires_grid_;
+    CMultiResGrid* sound_multires_grid_;
+    CMultiResGrid* human_multires_grid_;
+    ros::Publisher multires_grid_pub_;
+    ros::Publisher multires_local_maxima_pub_;
+    nav_msgs::OccupancyGrid multires_occupancy_grid_;
+    geometry_msgs::PoseArray multires_local_maxima_;
+
+    // Particle filter fed with the same detections
+    bool PARTICLE_FILTER_ENABLE_;
+    CParticleFilter* human_particle_filter_;
+    ros::Time particle_filter_last_time_;
+    ros::Publisher particle_grid_pub_;
+    ros::Publisher particle_projection_pub_;
+    nav_msgs::OccupancyGrid particle_occupancy_grid_;
+    geometry_msgs::PoseArray particle_projection_;
+    std::vector<float> particle_grid_;
+
+    // latest messages, handed over from the callback thread to spin()
+    CTripleBuffer<std::pair<geometry_msgs::PoseArrayConstPtr, nav_msgs::OdometryConstPtr> > sync_buffer_;
+    CTripleBuffer<hark_msgs::HarkSourceConstPtr> sound_buffer_;
+    CTripleBuffer<autonomy_human::raw_detectionsConstPtr> torso_buffer_;
+    CTripleBuffer<autonomy_human::raw_detectionsConstPtr> periodic_buffer_;
+
     void init();
+    void processSync(const geometry_msgs::PoseArrayConstPtr& leg_msg,
+                     const nav_msgs::OdometryConstPtr& encoder_msg);
+    void processSound(const hark_msgs::HarkSourceConstPtr &sound_msg);
+    void processTorso(const autonomy_human::raw_detectionsConstPtr &torso_msg);
+    void processPeriodic(const autonomy_human::raw_detectionsConstPtr &periodic_msg);
     bool transformToBase(geometry_msgs::PointStamped& source_point,
                          geometry_msgs::PointStamped& target_point,
                          bool debug = false);
@@ -128,6 +201,14 @@ private:
     void initSoundGrid(SensorFOV_t _fov);
     void initPeriodicGrid(SensorFOV_t _fov);
     void initHumanGrid(SensorFOV_t _fov);
+    CScrollingGrid* initWorldGrid(float fill);
+    void bayesOccupancyFilter(CGrid* grid, CScrollingGrid* world_grid);
+    CMultiResGrid* initMultiResGrid(const CGrid* grid);
+    void spinMultiRes();
+    void initParticleFilter();
+    void spinParticleFilter();
+    void fuseHumanGrid();
+    void publishTracks();
 
 public:
     ros::Time lk;
@@ -43,6 +43,10 @@ int main(int argc, char** argv)
                                             &CLikelihoodGrid::periodicCallBack,
                                             &likelihood_grid);
 
+    // Callbacks run on their own thread and only hand the messages over to spin()
+    ros::AsyncSpinner spinner(1);
+    spinner.start();
+
     while (ros::ok())
     {
         likelihood_grid.spin();
@@ -51,9 +55,6 @@ int main(int argc, char** argv)
             ROS_ERROR("It is taking too long! %f", looprate.cycleTime().toSec());
         if(!looprate.sleep())
             ROS_ERROR("Not enough time left");
-
-        ros::spinOnce();
-
     }
     return 0;
 }
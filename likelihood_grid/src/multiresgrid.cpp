@@ -0,0 +1,226 @@
+#include "multiresgrid.h"
+#include <cmath>
+#include <algorithm>
+
+CMultiResGrid::CMultiResGrid(float base_resolution,
+                             uint32_t cells_per_side,
+                             uint32_t levels,
+                             SensorFOV_t _sensor_fov,
+                             CellProbability_t _cell_probability,
+                             float _target_detection_probability,
+                             float _false_positive_probability):
+    base_resolution_(base_resolution),
+    cells_per_side_(cells_per_side),
+    levels_(levels),
+    TARGET_DETECTION_PROBABILITY_(_target_detection_probability),
+    FALSE_DETECTION_PROBABILITY_(_false_positive_probability),
+    export_resolution_(0.0),
+    export_size_(0),
+    cell_probability(_cell_probability),
+    sensor_fov(_sensor_fov)
+{
+    // the inner level has to cover whole cells of the outer one
+    ROS_ASSERT(cells_per_side_ % 4 == 0 && levels_ > 0 && base_resolution_ > 0.0);
+
+    const int n = cells_per_side_;
+    float resolution = base_resolution_;
+    MultiResCell_t c;
+
+    for(uint32_t l = 0; l < levels_; l++, resolution *= 2.0)
+    {
+        float half_size = n / 2 * resolution;
+        half_size_.push_back(half_size);
+        level_index_.push_back(std::vector<int>(n * n, -1));
+
+        for(int iy = 0; iy < n; iy++){
+            for(int ix = 0; ix < n; ix++){
+                // cells covered by the finer level
+                if(l > 0 && ix >= n / 4 && ix < 3 * n / 4 && iy >= n / 4 && iy < 3 * n / 4) continue;
+
+                c.x = -half_size + (ix + 0.5) * resolution;
+                c.y = -half_size + (iy + 0.5) * resolution;
+                c.size = resolution;
+                c.level = l;
+                c.polar.fromCart(c.x, c.y);
+                c.in_fov = (c.polar.range > sensor_fov.range.min &&
+                            c.polar.range < sensor_fov.range.max &&
+                            c.polar.angle > sensor_fov.angle.min &&
+                            c.polar.angle < sensor_fov.angle.max);
+
+                level_index_[l][ix + iy * n] = cell.size();
+                cell.push_back(c);
+            }
+        }
+    }
+
+    grid_size = cell.size();
+
+    /* 8-neighbourhood at each cell's own scale */
+    neighbours_.resize(grid_size * 8);
+    for(size_t i = 0; i < grid_size; i++){
+        int k = 0;
+        for(int dy = -1; dy <= 1; dy++){
+            for(int dx = -1; dx <= 1; dx++){
+                if(dx == 0 && dy == 0) continue;
+                neighbours_[i * 8 + k++] = cellAt(cell[i].x + dx * cell[i].size, cell[i].y + dy * cell[i].size);
+            }
+        }
+    }
+
+    posterior.resize(grid_size, cell_probability.unknown);
+    prior.resize(grid_size, cell_probability.unknown);
+    true_likelihood_.resize(grid_size, cell_probability.unknown);
+    false_likelihood_.resize(grid_size, cell_probability.unknown);
+    predicted_posterior_.resize(grid_size, cell_probability.unknown);
+
+    ROS_INFO("Multi-resolution grid: %u levels, %.2f m to %.2f m cells, %.1f m around the robot in %lu cells.",
+             levels_, base_resolution_, base_resolution_ * pow(2.0, levels_ - 1.0),
+             half_size_.back(), grid_size);
+}
+
+int CMultiResGrid::cellAt(float x, float y) const
+{
+    float r = std::max(fabs(x), fabs(y));
+    uint32_t l = 0;
+    while(l < levels_ && r >= half_size_[l]) l++;
+    if(l == levels_) return -1;
+
+    const int n = cells_per_side_;
+    while(true){
+        float resolution = base_resolution_ * (1 << l);
+        int ix = (int) floor((x + half_size_[l]) / resolution);
+        int iy = (int) floor((y + half_size_[l]) / resolution);
+        ix = std::min(std::max(ix, 0), n - 1);
+        iy = std::min(std::max(iy, 0), n - 1);
+
+        int index = level_index_[l][ix + iy * n];
+
+        // float rounding right on the border of the finer level
+        if(index >= 0 || l == 0) return index;
+        l--;
+    }
+}
+
+void CMultiResGrid::computeLikelihood(const std::vector<PolarPose>& pose,
+                                      std::vector<float>& true_likelihood,
+                                      std::vector<float>& false_likelihood)
+{
+    const float angle_stdev = angles::from_degrees(stdev.angle);
+
+    for(size_t i = 0; i < grid_size; i++){
+        float detection_likelihood = cell_probability.unknown;
+        float miss_detection_likelihood = cell_probability.unknown;
+
+        if(cell[i].in_fov){
+            if(pose.empty()) miss_detection_likelihood = cell_probability.human;
+            else{
+                float cell_prob = 0.0;
+                for(size_t p = 0; p < pose.size(); p++){
+                    float Gr = (pose[p].range < 0.01) ? 1.0 : normalDistribution(cell[i].polar.range, pose[p].range, stdev.range);
+                    float Ga = normalDistribution(angles::normalize_angle(cell[i].polar.angle - pose[p].angle), 0.0, angle_stdev);
+                    cell_prob += Gr * Ga;
+                }
+                cell_prob /= pose.size();
+                detection_likelihood = (cell_prob < cell_probability.free) ? cell_probability.free : cell_prob;
+            }
+        }
+
+        true_likelihood[i] = (detection_likelihood * TARGET_DETECTION_PROBABILITY_) + (miss_detection_likelihood * (1.0 - TARGET_DETECTION_PROBABILITY_));
+        false_likelihood[i] = (detection_likelihood * FALSE_DETECTION_PROBABILITY_) + (miss_detection_likelihood * (1.0 - FALSE_DETECTION_PROBABILITY_));
+    }
+}
+
+void CMultiResGrid::updateGridProbability(const std::vector<float>& prior,
+                                          const std::vector<float>& true_likelihood,
+                                          const std::vector<float>& false_likelihood,
+                                          std::vector<float>& posterior)
+{
+    for(size_t i = 0; i < grid_size; i++){
+        float normalizer_factor = (true_likelihood[i] * prior[i]) + (false_likelihood[i] * (1.0 - prior[i]));
+        float p = (true_likelihood[i] * prior[i]) / normalizer_factor;
+        p = (p > cell_probability.human) ? p * cell_probability.human : p;
+        p = (p < cell_probability.free) ? cell_probability.free : p;
+
+        //PROBABILITY IN unknown AREA CANNOT BE LESS THAN unknown PROBABILITY
+        if(!cell[i].in_fov && p < cell_probability.unknown) p = cell_probability.unknown;
+        posterior[i] = p;
+    }
+}
+
+void CMultiResGrid::bayesOccupancyFilter(const std::vector<PolarPose>& predicted,
+                                         const std::vector<PolarPose>& current)
+{
+    computeLikelihood(predicted, true_likelihood_, false_likelihood_);
+    updateGridProbability(prior, true_likelihood_, false_likelihood_, predicted_posterior_);
+
+    computeLikelihood(current, true_likelihood_, false_likelihood_);
+    updateGridProbability(predicted_posterior_, true_likelihood_, false_likelihood_, posterior);
+
+    prior = posterior;
+}
+
+void CMultiResGrid::localMaxima(float threshold, float min_separation, geometry_msgs::PoseArray& maxima) const
+{
+    std::vector<std::pair<float, size_t> > peaks;
+
+    for(size_t i = 0; i < grid_size; i++){
+        if(posterior[i] < threshold) continue;
+
+        bool is_peak = true;
+        for(int k = 0; k < 8 && is_peak; k++){
+            int j = neighbours_[i * 8 + k];
+            is_peak = (j < 0 || posterior[j] <= posterior[i]);
+        }
+        if(is_peak) peaks.push_back(std::make_pair(posterior[i], i));
+    }
+
+    /* Strongest first; flat plateaus and mixed cell sizes give neighbouring peaks */
+    std::sort(peaks.rbegin(), peaks.rend());
+
+    maxima.poses.clear();
+    geometry_msgs::Pose pose;
+    for(size_t p = 0; p < peaks.size(); p++){
+        const MultiResCell_t& c = cell[peaks[p].second];
+
+        bool too_close = false;
+        for(size_t m = 0; m < maxima.poses.size() && !too_close; m++){
+            float dx = maxima.poses[m].position.x - c.x;
+            float dy = maxima.poses[m].position.y - c.y;
+            too_close = (dx * dx + dy * dy < min_separation * min_separation);
+        }
+        if(too_close) continue;
+
+        pose.position.x = c.x;
+        pose.position.y = c.y;
+        pose.position.z = peaks[p].first;
+        maxima.poses.push_back(pose);
+    }
+}
+
+void CMultiResGrid::toOccupancyGrid(float resolution, uint32_t size, nav_msgs::OccupancyGrid& occupancy_grid)
+{
+    if(resolution != export_resolution_ || size != export_size_){
+        export_resolution_ = resolution;
+        export_size_ = size;
+        export_index_.resize(size * size);
+
+        float origin = -(float) size * resolution / 2.0;
+        for(uint32_t y = 0; y < size; y++)
+            for(uint32_t x = 0; x < size; x++)
+                export_index_[x + y * size] = cellAt(origin + (x + 0.5) * resolution, origin + (y + 0.5) * resolution);
+
+        occupancy_grid.info.width = size;
+        occupancy_grid.info.height = size;
+        occupancy_grid.info.resolution = resolution;
+        occupancy_grid.info.origin.position.x = origin;
+        occupancy_grid.info.origin.position.y = origin;
+        occupancy_grid.info.origin.orientation.w = 1.0;
+        occupancy_grid.header.frame_id = "base_footprint";
+    }
+
+    occupancy_grid.data.resize(size * size);
+    for(size_t i = 0; i < export_index_.size(); i++){
+        int c = export_index_[i];
+        occupancy_grid.data[i] = (c < 0) ? -1 : (int8_t) (100 * posterior[c]);
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef MULTIRESGRID_H
+#define MULTIRESGRID_H
+
+#include <vector>
+#include <nav_msgs/OccupancyGrid.h>
+#include <geometry_msgs/PoseArray.h>
+#include "grid.h"
+
+/*
+ * Robot-centric grid with concentric square levels. Level 0 has the finest
+ * resolution; every further level doubles both the cell size and the extent,
+ * and only keeps the cells outside the level inside it (a square ring).
+ *
+ *  level k: resolution = base_resolution * 2^k
+ *           extent     = [-half_size_k, half_size_k), half_size_k = cells_per_side/2 * resolution
+ *
+ * All cells of all levels live in one flat list so the per-cell kernels
+ * (likelihood, Bayes update) are plain loops and the posteriors of grids
+ * built alike can be fused cell by cell with CGridFusion. An OccupancyGrid of any
+ * uniform resolution is resampled from it on demand.
+ */
+
+struct MultiResCell_t{
+    float x;
+    float y;
+    float size;                 // [m]
+    PolarPose polar;
+    bool in_fov;
+    uint8_t level;
+};
+
+class CMultiResGrid
+{
+private:
+    float base_resolution_;
+    uint32_t cells_per_side_;
+    uint32_t levels_;
+    std::vector<float> half_size_;              // per level [m]
+    std::vector<std::vector<int> > level_index_;  // per level, (ix + iy * n) -> flat cell, -1 inside the finer level
+
+    std::vector<float> true_likelihood_;
+    std::vector<float> false_likelihood_;
+    std::vector<float> predicted_posterior_;
+    std::vector<int> neighbours_;               // 8 per cell, -1 outside the grid
+
+    float TARGET_DETECTION_PROBABILITY_;
+    float FALSE_DETECTION_PROBABILITY_;
+
+    // resampling table of the last exported geometry
+    float export_resolution_;
+    uint32_t export_size_;
+    std::vector<int> export_index_;
+
+    void computeLikelihood(const std::vector<PolarPose>& pose,
+                           std::vector<float>& true_likelihood,
+                           std::vector<float>& false_likelihood);
+    void updateGridProbability(const std::vector<float>& prior,
+                               const std::vector<float>& true_likelihood,
+                               const std::vector<float>& false_likelihood,
+                               std::vector<float>& posterior);
+
+public:
+    std::vector<MultiResCell_t> cell;
+    size_t grid_size;
+    PolarPose stdev;
+    CellProbability_t cell_probability;
+    SensorFOV_t sensor_fov;
+
+    std::vector<float> posterior;
+    std::vector<float> prior;
+
+    CMultiResGrid(float base_resolution,
+                  uint32_t cells_per_side,
+                  uint32_t levels,
+                  SensorFOV_t _sensor_fov,
+                  CellProbability_t _cell_probability,
+                  float _target_detection_probability,
+                  float _false_positive_probability);
+
+    int cellAt(float x, float y) const;         // -1 outside the grid
+    float maxRange() const {return half_size_.back();}
+
+    void bayesOccupancyFilter(const std::vector<PolarPose>& predicted,
+                              const std::vector<PolarPose>& current);
+    void localMaxima(float threshold, float min_separation, geometry_msgs::PoseArray& maxima) const;
+    void toOccupancyGrid(float resolution, uint32_t size, nav_msgs::OccupancyGrid& occupancy_grid);
+};
+
+#endif // MULTIRESGRID_H
@@ -0,0 +1,187 @@
+#include "multitracker.h"
+#include <ros/ros.h>
+#include <cmath>
+#include <algorithm>
+
+CMultiTargetTracker::CMultiTargetTracker(float measurement_noise, float acceleration_noise,
+                                         float initial_speed, float gate,
+                                         float max_distance, int confirm_count):
+    measurement_noise_(measurement_noise),
+    acceleration_noise_(acceleration_noise),
+    initial_speed_(initial_speed),
+    gate_(gate),
+    max_distance_(max_distance),
+    confirm_count_(confirm_count),
+    next_id_(1),
+    // only assign() is used, the polar gating parameters do not matter
+    association_(ASSOCIATION_POLAR, 1.0, 1.0, 1.0, 1.0)
+{
+}
+
+void CMultiTargetTracker::predictTrack(HumanTrack_t& track, float dt) const
+{
+    float* s = track.state;
+    float* P = track.cov;
+
+    s[0] += s[2] * dt;
+    s[1] += s[3] * dt;
+
+    /*
+     * P = F P F' + Q with F = [I dt*I; 0 I]. Rows, then columns:
+     * position rows gain dt * the velocity rows.
+     */
+    for(int c = 0; c < 4; c++)
+    {
+        P[0 * 4 + c] += dt * P[2 * 4 + c];
+        P[1 * 4 + c] += dt * P[3 * 4 + c];
+    }
+    for(int r = 0; r < 4; r++)
+    {
+        P[r * 4 + 0] += dt * P[r * 4 + 2];
+        P[r * 4 + 1] += dt * P[r * 4 + 3];
+    }
+
+    /* White acceleration noise, per axis */
+    float q = acceleration_noise_ * acceleration_noise_;
+    float q_pp = q * dt * dt * dt * dt / 4.0;
+    float q_pv = q * dt * dt * dt / 2.0;
+    float q_vv = q * dt * dt;
+    for(int a = 0; a < 2; a++)
+    {
+        P[a * 4 + a] += q_pp;
+        P[a * 4 + a + 2] += q_pv;
+        P[(a + 2) * 4 + a] += q_pv;
+        P[(a + 2) * 4 + a + 2] += q_vv;
+    }
+}
+
+bool CMultiTargetTracker::gatedCost(const HumanTrack_t& track, const TrackMeasurement_t& z, float& cost) const
+{
+    const float* P = track.cov;
+    float dx = z.x - track.state[0];
+    float dy = z.y - track.state[1];
+    if(dx * dx + dy * dy > max_distance_ * max_distance_) return false;
+
+    float sxx = P[0] + measurement_noise_;
+    float sxy = P[1];
+    float syy = P[5] + measurement_noise_;
+    float det = sxx * syy - sxy * sxy;
+    if(det <= 0.0) return false;
+
+    float d2 = (syy * dx * dx - 2.0 * sxy * dx * dy + sxx * dy * dy) / det;
+    if(d2 > gate_) return false;
+
+    cost = d2;
+    return true;
+}
+
+void CMultiTargetTracker::correctTrack(HumanTrack_t& track, const TrackMeasurement_t& z) const
+{
+    float* s = track.state;
+    float* P = track.cov;
+
+    /* H = [I 0], S = P(0:1, 0:1) + R */
+    float sxx = P[0] + measurement_noise_;
+    float sxy = P[1];
+    float syy = P[5] + measurement_noise_;
+    float det = sxx * syy - sxy * sxy;
+    float ixx = syy / det, ixy = -sxy / det, iyy = sxx / det;
+
+    /* K = P H' S^-1, 4x2 */
+    float K[8];
+    for(int r = 0; r < 4; r++)
+    {
+        K[r * 2 + 0] = P[r * 4 + 0] * ixx + P[r * 4 + 1] * ixy;
+        K[r * 2 + 1] = P[r * 4 + 0] * ixy + P[r * 4 + 1] * iyy;
+    }
+
+    float dx = z.x - s[0];
+    float dy = z.y - s[1];
+    for(int r = 0; r < 4; r++)
+        s[r] += K[r * 2 + 0] * dx + K[r * 2 + 1] * dy;
+
+    /* P = (I - K H) P, only the first two rows of P are read */
+    float P0[4], P1[4];
+    std::copy(P, P + 4, P0);
+    std::copy(P + 4, P + 8, P1);
+    for(int r = 0; r < 4; r++)
+        for(int c = 0; c < 4; c++)
+            P[r * 4 + c] -= K[r * 2 + 0] * P0[c] + K[r * 2 + 1] * P1[c];
+
+    track.probability = z.probability;
+}
+
+void CMultiTargetTracker::update(const std::vector<TrackMeasurement_t>& meas, float dt)
+{
+    if(dt < 0.0) dt = 0.0;
+
+    for(size_t i = 0; i < tracks_.size(); i++)
+        predictTrack(tracks_[i], dt);
+
+    /* Gated cost matrix, tracks x measurements */
+    cost_.assign(tracks_.size() * meas.size(), CDataAssociation::NO_MATCH_COST);
+    float c;
+    for(size_t i = 0; i < tracks_.size(); i++)
+        for(size_t j = 0; j < meas.size(); j++)
+            if(gatedCost(tracks_[i], meas[j], c)) cost_[i * meas.size() + j] = c;
+
+    association_.assign(cost_, tracks_.size(), meas.size(), assignment_);
+    matched_.assign(meas.size(), 0);
+
+    for(size_t i = 0; i < tracks_.size(); i++)
+    {
+        HumanTrack_t& track = tracks_[i];
+        if(assignment_[i] >= 0)
+        {
+            correctTrack(track, meas[assignment_[i]]);
+            matched_[assignment_[i]] = 1;
+            if(++track.counter > confirm_count_)
+            {
+                track.confirmed = true;
+                track.counter = confirm_count_ + 1;
+            }
+        }
+        else
+        {
+            track.counter--;
+        }
+    }
+
+    /* Drop the tracks without points left, keeping the order */
+    size_t kept = 0;
+    for(size_t i = 0; i < tracks_.size(); i++)
+    {
+        if(tracks_[i].counter > 0)
+        {
+            if(kept != i) tracks_[kept] = tracks_[i];
+            kept++;
+        }
+    }
+    tracks_.resize(kept);
+
+    /* New tracks from the measurements nobody claimed */
+    for(size_t j = 0; j < meas.size(); j++)
+    {
+        if(matched_[j]) continue;
+
+        HumanTrack_t track;
+        track.id = next_id_++;
+        track.state[0] = meas[j].x;
+        track.state[1] = meas[j].y;
+        track.state[2] = track.state[3] = 0.0;
+        std::fill(track.cov, track.cov + 16, 0.0);
+        track.cov[0] = track.cov[5] = measurement_noise_;
+        track.cov[10] = track.cov[15] = initial_speed_ * initial_speed_;
+        track.probability = meas[j].probability;
+        track.counter = 1;
+        track.confirmed = false;
+        tracks_.push_back(track);
+    }
+}
+
+const HumanTrack_t* CMultiTargetTracker::find(uint32_t id) const
+{
+    for(size_t i = 0; i < tracks_.size(); i++)
+        if(tracks_[i].id == id) return &tracks_[i];
+    return NULL;
+}
@@ -0,0 +1,70 @@
+#ifndef MULTITRACKER_H
+#define MULTITRACKER_H
+
+#include <vector>
+#include <stdint.h>
+#include "dataassociation.h"
+
+/*
+ * Multi-target tracker for the people found as local maxima of a grid.
+ *
+ * Every track is a constant velocity Kalman filter (x, y, vx, vy) in the
+ * grid frame, so velocities are relative to the robot. Each update predicts
+ * the tracks, gates the measurements on the Mahalanobis distance and assigns
+ * them globally (CDataAssociation::assign). A matched track gains a point, a
+ * missed one loses one; it is confirmed once it has more than confirm_count
+ * points and removed when it has none left. New tracks get a new id, ids
+ * are never reused.
+ */
+
+struct TrackMeasurement_t{
+    float x;
+    float y;
+    float probability;
+};
+
+struct HumanTrack_t{
+    uint32_t id;
+    float state[4];         // x, y, vx, vy
+    float cov[16];          // row-major 4x4
+    float probability;      // of the last matched measurement
+    int counter;
+    bool confirmed;
+};
+
+class CMultiTargetTracker
+{
+private:
+    float measurement_noise_;   // [m^2]
+    float acceleration_noise_;  // [m/s^2], standard deviation
+    float initial_speed_;       // [m/s], standard deviation of a new track's velocity
+    float gate_;
+    float max_distance_;
+    int confirm_count_;
+
+    uint32_t next_id_;
+    std::vector<HumanTrack_t> tracks_;
+
+    CDataAssociation association_;
+    std::vector<float> cost_;
+    std::vector<int> assignment_;
+    std::vector<char> matched_;
+
+    void predictTrack(HumanTrack_t& track, float dt) const;
+    void correctTrack(HumanTrack_t& track, const TrackMeasurement_t& z) const;
+    bool gatedCost(const HumanTrack_t& track, const TrackMeasurement_t& z, float& cost) const;
+
+public:
+    CMultiTargetTracker(float measurement_noise = 0.1, float acceleration_noise = 1.0,
+                        float initial_speed = 1.5, float gate = 9.21,
+                        float max_distance = 1.0, int confirm_count = 10);
+
+    void setMeasurementNoise(float measurement_noise) {measurement_noise_ = measurement_noise;}
+    void update(const std::vector<TrackMeasurement_t>& meas, float dt);
+    void clear() {tracks_.clear();}
+
+    const std::vector<HumanTrack_t>& tracks() const {return tracks_;}
+    const HumanTrack_t* find(uint32_t id) const;
+};
+
+#endif // MULTITRACKER_H
@@ -0,0 +1,423 @@
+#include "particlefilter.h"
+#include <ros/ros.h>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <cmath>
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+const size_t PARALLEL_MIN_PARTICLES = 16384;    // below this a thread costs more than it saves
+const float NO_RANGE_MIN = 0.01;                // detections outside [min, max] carry no range
+const float NO_RANGE_MAX = 20.0;
+
+inline uint32_t xorshift(uint32_t& state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+inline float uniform(uint32_t& state)
+{
+    return (xorshift(state) >> 8) * (1.0f / 16777216.0f);
+}
+
+inline float gaussian(uint32_t& state)
+{
+    float u1 = std::max(uniform(state), 1e-7f);
+    float u2 = uniform(state);
+    return sqrtf(-2.0f * logf(u1)) * cosf(2.0f * M_PI * u2);
+}
+
+inline float wrapAngle(float a)
+{
+    a = (a > M_PI) ? a - 2.0f * M_PI : a;
+    return (a < -M_PI) ? a + 2.0f * M_PI : a;
+}
+
+#ifdef __SSE2__
+/* exp(x) for x <= 0, Cephes polynomial, relative error ~2e-7 */
+inline __m128 expNegative(__m128 x)
+{
+    x = _mm_max_ps(x, _mm_set1_ps(-80.0f));
+    __m128i n = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)));
+    __m128 fn = _mm_cvtepi32_ps(n);
+    x = _mm_sub_ps(x, _mm_mul_ps(fn, _mm_set1_ps(0.693359375f)));
+    x = _mm_sub_ps(x, _mm_mul_ps(fn, _mm_set1_ps(-2.12194440e-4f)));
+
+    __m128 y = _mm_set1_ps(1.9875691500E-4f);
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.3981999507E-3f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(8.3334519073E-3f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(4.1665795894E-2f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.6666665459E-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(5.0000001201E-1f));
+    y = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(y, x), x), _mm_add_ps(x, _mm_set1_ps(1.0f)));
+
+    __m128i e = _mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23);
+    return _mm_mul_ps(y, _mm_castsi128_ps(e));
+}
+#endif
+}
+
+CParticleFilter::CParticleFilter(const SensorFOV_t& fov,
+                                 const CellProbability_t& cell_probability,
+                                 size_t particles_per_person,
+                                 size_t min_particles,
+                                 size_t max_particles,
+                                 float detection_probability,
+                                 float false_positive_probability,
+                                 float birth_ratio,
+                                 float speed_noise,
+                                 float max_speed,
+                                 int threads):
+    fov_(fov),
+    cell_probability_(cell_probability),
+    particles_per_person_(particles_per_person),
+    min_particles_(min_particles),
+    max_particles_(std::max(max_particles, min_particles)),
+    detection_probability_(detection_probability),
+    false_positive_probability_(false_positive_probability),
+    birth_ratio_(birth_ratio),
+    speed_noise_(speed_noise),
+    max_speed_(max_speed),
+    threads_(std::max(threads, 1)),
+    seed_(2463534242u),
+    people_(0)
+{
+    ROS_ASSERT(min_particles_ > 0);
+    resize(min_particles_);
+    spawnUniform(min_particles_);
+}
+
+void CParticleFilter::resize(size_t n)
+{
+    x_.resize(n);
+    y_.resize(n);
+    vx_.resize(n);
+    vy_.resize(n);
+    w_.resize(n);
+    range_.resize(n);
+    angle_.resize(n);
+    detection_sum_.resize(n);
+}
+
+void CParticleFilter::spawnUniform(size_t n)
+{
+    /* Uniform over the FOV area: range ~ sqrt of uniform in r^2 */
+    float r2_min = fov_.range.min * fov_.range.min;
+    float r2_max = fov_.range.max * fov_.range.max;
+    for(size_t i = 0; i < n; i++)
+    {
+        float r = sqrtf(r2_min + uniform(seed_) * (r2_max - r2_min));
+        float a = fov_.angle.min + uniform(seed_) * (fov_.angle.max - fov_.angle.min);
+        x_[i] = r * cosf(a);
+        y_[i] = r * sinf(a);
+        vx_[i] = vy_[i] = 0.0;
+        w_[i] = 1.0 / n;
+    }
+}
+
+void CParticleFilter::spawn(size_t i, const Birth_t& birth, uint32_t& state)
+{
+    float r;
+    if(birth.pose.range < NO_RANGE_MIN || birth.pose.range > NO_RANGE_MAX)
+        r = fov_.range.min + uniform(state) * (fov_.range.max - fov_.range.min);
+    else
+        r = std::max(birth.pose.range + birth.stdev_range * gaussian(state), 0.0f);
+    float a = birth.pose.angle + birth.stdev_angle * gaussian(state);
+
+    nx_[i] = r * cosf(a);
+    ny_[i] = r * sinf(a);
+    nvx_[i] = nvy_[i] = 0.0;
+}
+
+void CParticleFilter::runParallel(RangeFunction f, size_t n)
+{
+    size_t chunks = (n < PARALLEL_MIN_PARTICLES) ? 1 : (size_t) threads_;
+    if(chunks == 1)
+    {
+        (this->*f)(0, n, 0);
+        return;
+    }
+
+    /* Chunks of four particles so that the SIMD loops have no tail but the last */
+    size_t step = ((n + chunks - 1) / chunks + 3) & ~((size_t) 3);
+    boost::thread_group workers;
+    for(size_t c = 1; c < chunks; c++)
+    {
+        size_t begin = std::min(c * step, n);
+        size_t end = std::min(begin + step, n);
+        workers.create_thread(boost::bind(f, this, begin, end, c));
+    }
+    (this->*f)(0, std::min(step, n), 0);
+    workers.join_all();
+}
+
+void CParticleFilter::predict(const Velocity_t& robot_velocity, float dt)
+{
+    if(dt <= 0.0) return;
+    robot_velocity_ = &robot_velocity;
+    dt_ = dt;
+    xorshift(seed_);
+    runParallel(&CParticleFilter::predictRange, size());
+}
+
+void CParticleFilter::predictRange(size_t begin, size_t end, size_t chunk)
+{
+    /* Robot displacement over dt in its previous frame, as CGridWarp */
+    float dyaw = robot_velocity_->angular * dt_;
+    float half_yaw = dyaw * 0.5;
+    float mx = robot_velocity_->lin.x * dt_;
+    float my = robot_velocity_->lin.y * dt_;
+    float dx = cos(half_yaw) * mx - sin(half_yaw) * my;
+    float dy = sin(half_yaw) * mx + cos(half_yaw) * my;
+    float c = cos(-dyaw), s = sin(-dyaw);
+
+    float noise = speed_noise_ * sqrtf(dt_);
+    float max_speed2 = max_speed_ * max_speed_;
+    uint32_t state = seed_ ^ (uint32_t) (0x9E3779B9u * (chunk + 1));
+
+    for(size_t i = begin; i < end; i++)
+    {
+        /* People: constant velocity with random acceleration, no faster than max_speed_ */
+        vx_[i] += noise * gaussian(state);
+        vy_[i] += noise * gaussian(state);
+        float speed2 = vx_[i] * vx_[i] + vy_[i] * vy_[i];
+        if(speed2 > max_speed2)
+        {
+            float k = max_speed_ / sqrtf(speed2);
+            vx_[i] *= k;
+            vy_[i] *= k;
+        }
+        float px = x_[i] + vx_[i] * dt_ - dx;
+        float py = y_[i] + vy_[i] * dt_ - dy;
+
+        /* Into the new robot frame */
+        x_[i] = c * px - s * py;
+        y_[i] = s * px + c * py;
+        float vx = c * vx_[i] - s * vy_[i];
+        vy_[i] = s * vx_[i] + c * vy_[i];
+        vx_[i] = vx;
+    }
+}
+
+void CParticleFilter::update(const std::vector<PolarPose>& detections, const PolarPose& stdev,
+                             const SensorFOV_t& sensor_fov)
+{
+    detections_ = &detections;
+    inv_stdev_range_ = 1.0 / stdev.range;
+    inv_stdev_angle_ = 1.0 / angles::from_degrees(stdev.angle);
+    sensor_fov_ = &sensor_fov;
+
+    runParallel(&CParticleFilter::likelihoodRange, size());
+
+    people_ = std::max(people_, detections.size());
+    Birth_t birth;
+    birth.stdev_range = stdev.range;
+    birth.stdev_angle = angles::from_degrees(stdev.angle);
+    for(size_t d = 0; d < detections.size(); d++)
+    {
+        birth.pose = detections[d];
+        births_.push_back(birth);
+    }
+}
+
+void CParticleFilter::likelihoodRange(size_t begin, size_t end, size_t chunk)
+{
+    const std::vector<PolarPose>& det = *detections_;
+    const SensorFOV_t& fov = *sensor_fov_;
+
+    for(size_t i = begin; i < end; i++)
+    {
+        range_[i] = sqrtf(x_[i] * x_[i] + y_[i] * y_[i]);
+        angle_[i] = atan2f(y_[i], x_[i]);
+        detection_sum_[i] = 0.0;
+    }
+
+    /*
+     * sum over the detections of exp(-(dr^2 + da^2) / 2), dr and da in
+     * stdevs; detections are the outer loop so that the inner one streams
+     * over the particle arrays.
+     */
+    for(size_t d = 0; d < det.size(); d++)
+    {
+        bool has_range = !(det[d].range < NO_RANGE_MIN || det[d].range > NO_RANGE_MAX);
+        float u_range = det[d].range;
+        float u_angle = det[d].angle;
+        float k_range = has_range ? inv_stdev_range_ : 0.0f;
+        float k_angle = inv_stdev_angle_;
+
+        size_t i = begin;
+#ifdef __SSE2__
+        const __m128 ur = _mm_set1_ps(u_range), ua = _mm_set1_ps(u_angle);
+        const __m128 kr = _mm_set1_ps(k_range), ka = _mm_set1_ps(k_angle);
+        const __m128 pi = _mm_set1_ps(M_PI), two_pi = _mm_set1_ps(2.0 * M_PI);
+        const __m128 minus_pi = _mm_set1_ps(-M_PI), minus_half = _mm_set1_ps(-0.5f);
+        for(; i + 4 <= end; i += 4)
+        {
+            __m128 dr = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&range_[i]), ur), kr);
+            __m128 da = _mm_sub_ps(_mm_loadu_ps(&angle_[i]), ua);
+            da = _mm_sub_ps(da, _mm_and_ps(_mm_cmpgt_ps(da, pi), two_pi));
+            da = _mm_add_ps(da, _mm_and_ps(_mm_cmplt_ps(da, minus_pi), two_pi));
+            da = _mm_mul_ps(da, ka);
+            __m128 e = _mm_mul_ps(minus_half, _mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(da, da)));
+            _mm_storeu_ps(&detection_sum_[i], _mm_add_ps(_mm_loadu_ps(&detection_sum_[i]), expNegative(e)));
+        }
+#endif
+        for(; i < end; i++)
+        {
+            float dr = (range_[i] - u_range) * k_range;
+            float da = wrapAngle(angle_[i] - u_angle) * k_angle;
+            detection_sum_[i] += expf(-0.5f * (dr * dr + da * da));
+        }
+    }
+
+    /*
+     * Detection and miss detection likelihoods as in CGrid::cellLikelihood,
+     * mixed into the true and false target likelihoods; out of the FOV both
+     * are unknown and the weight does not change.
+     */
+    const float pd = detection_probability_;
+    const float pf = false_positive_probability_;
+    const float inv_size = det.empty() ? 0.0 : 1.0 / det.size();
+    for(size_t i = begin; i < end; i++)
+    {
+        bool in_fov = range_[i] > fov.range.min && range_[i] < fov.range.max &&
+                angle_[i] > fov.angle.min && angle_[i] < fov.angle.max;
+        if(!in_fov) continue;
+
+        float detection, miss_detection;
+        if(det.empty())
+        {
+            detection = cell_probability_.unknown;
+            miss_detection = cell_probability_.human;
+        }
+        else
+        {
+            detection = std::max(detection_sum_[i] * inv_size, cell_probability_.free);
+            miss_detection = cell_probability_.unknown;
+        }
+        w_[i] *= (detection * pd + miss_detection * (1.0f - pd)) /
+                 (detection * pf + miss_detection * (1.0f - pf));
+    }
+}
+
+void CParticleFilter::resample()
+{
+    size_t n = size();
+    double sum = 0.0;
+    float r2_min = fov_.range.min * fov_.range.min;
+    float r2_max = fov_.range.max * fov_.range.max;
+    for(size_t i = 0; i < n; i++)
+    {
+        /* Particles that left the FOV of the filter, in range or in angle */
+        float r2 = x_[i] * x_[i] + y_[i] * y_[i];
+        float a = atan2f(y_[i], x_[i]);
+        if(r2 < r2_min || r2 > r2_max || a < fov_.angle.min || a > fov_.angle.max) w_[i] = 0.0;
+        sum += w_[i];
+    }
+
+    size_t target = n;
+    if(!births_.empty())
+        target = std::min(std::max(particles_per_person_ * (people_ + 1), min_particles_), max_particles_);
+
+    if(!(sum > 0.0))
+    {
+        ROS_WARN("Particle filter: all weights vanished, spreading the particles again.");
+        resize(target);
+        spawnUniform(target);
+        births_.clear();
+        people_ = 0;
+        return;
+    }
+
+    size_t born = births_.empty() ? 0 : (size_t) (birth_ratio_ * target);
+    size_t kept = target - born;
+
+    nx_.resize(target);
+    ny_.resize(target);
+    nvx_.resize(target);
+    nvy_.resize(target);
+
+    /* Systematic resampling: one random offset, kept evenly spaced pointers */
+    double step = sum / kept;
+    double u = uniform(seed_) * step;
+    double cumulative = w_[0];
+    size_t j = 0;
+    for(size_t k = 0; k < kept; k++)
+    {
+        while(u > cumulative && j + 1 < n) cumulative += w_[++j];
+        nx_[k] = x_[j];
+        ny_[k] = y_[j];
+        nvx_[k] = vx_[j];
+        nvy_[k] = vy_[j];
+        u += step;
+    }
+
+    for(size_t k = kept; k < target; k++)
+        spawn(k, births_[(k - kept) % births_.size()], seed_);
+
+    resize(target);
+    x_.swap(nx_);
+    y_.swap(ny_);
+    vx_.swap(nvx_);
+    vy_.swap(nvy_);
+    std::fill(w_.begin(), w_.end(), (float) (1.0 / target));
+
+    births_.clear();
+    people_ = 0;
+}
+
+void CParticleFilter::rasterise(const MapMetaData_t& map, std::vector<float>& grid) const
+{
+    grid.assign(map.height * map.width, 0.0);
+    float inv_resolution = 1.0 / map.resolution;
+    float x0 = map.origin.position.x;
+    float y0 = map.origin.position.y;
+
+    /* cell (r, c) = r + c * height, r along x */
+    for(size_t i = 0; i < size(); i++)
+    {
+        int r = (int) floorf((x_[i] - x0) * inv_resolution);
+        int c = (int) floorf((y_[i] - y0) * inv_resolution);
+        if(r < 0 || c < 0 || r >= (int) map.height || c >= (int) map.width) continue;
+        grid[r + c * map.height] += w_[i];
+    }
+
+    float max = *std::max_element(grid.begin(), grid.end());
+    if(max > 0.0)
+        for(size_t i = 0; i < grid.size(); i++) grid[i] /= max;
+}
+
+void CParticleFilter::project(int angle_step, geometry_msgs::PoseArray& projection) const
+{
+    int bins = 360 / angle_step;
+    projection.header.stamp = ros::Time::now();
+    projection.header.frame_id = "base_footprint";
+    projection.poses.resize(bins);
+
+    for(int b = 0; b < bins; b++)
+    {
+        projection.poses[b].position.x = cos(b * angle_step * M_PI / 180);
+        projection.poses[b].position.y = sin(b * angle_step * M_PI / 180);
+        projection.poses[b].position.z = 0.0;
+    }
+
+    for(size_t i = 0; i < size(); i++)
+    {
+        float angle = atan2f(y_[i], x_[i]) * 180 / M_PI;
+        if(angle < 0) angle += 360;
+        int b = std::min((int) (angle / angle_step), bins - 1);
+        projection.poses[b].position.z += w_[i];
+    }
+
+    double max = 0.0;
+    for(int b = 0; b < bins; b++) max = std::max(max, projection.poses[b].position.z);
+    if(max > 0.0)
+        for(int b = 0; b < bins; b++) projection.poses[b].position.z /= max;
+}
@@ -0,0 +1,104 @@
+#ifndef PARTICLEFILTER_H
+#define PARTICLEFILTER_H
+
+#include <vector>
+#include <stdint.h>
+#include <geometry_msgs/PoseArray.h>
+#include "grid.h"
+
+/*
+ * Particle representation of where the people around the robot are, as an
+ * alternative to the dense human grid. Every particle is a hypothesis of one
+ * person (x, y, vx, vy) in base_footprint; the particle count follows the
+ * number of people detected (particles_per_person each), not the area.
+ *
+ * The sensor model is the one of CGrid: a Gaussian in range and angle around
+ * every detection of a sensor with the sensor's stdev (scaled to 1 at its
+ * peak), the range ignored for detections without one. A particle's weight
+ * is multiplied by the ratio of the true to the false target likelihood a
+ * grid cell at its position would get, so it is 1 outside the sensor FOV.
+ * Particles leaving the FOV of the filter are dropped. They are stored as a structure
+ * of arrays; the likelihood is evaluated four particles at a time with SSE2
+ * and can be split over worker threads. Resampling is systematic, with a
+ * share of new particles born around the detections of the cycle.
+ *
+ * Grids and projections are rendered from the particles only when asked.
+ */
+
+class CParticleFilter
+{
+private:
+    SensorFOV_t fov_;                   // where people are looked for
+    CellProbability_t cell_probability_;
+    size_t particles_per_person_;
+    size_t min_particles_;
+    size_t max_particles_;
+    float detection_probability_;
+    float false_positive_probability_;
+    float birth_ratio_;
+    float speed_noise_;                 // [m/s], per sqrt(s)
+    float max_speed_;                   // [m/s], the random walk of the velocity stops here
+    int threads_;
+    uint32_t seed_;
+
+    // particles
+    std::vector<float> x_, y_, vx_, vy_, w_;
+    std::vector<float> range_, angle_, detection_sum_;
+    std::vector<float> nx_, ny_, nvx_, nvy_;    // resampling target
+
+    // detections of the current cycle, for the births
+    struct Birth_t{
+        PolarPose pose;
+        float stdev_range;
+        float stdev_angle;
+    };
+    std::vector<Birth_t> births_;
+    size_t people_;
+
+    // arguments of the range functions run on the workers
+    const Velocity_t* robot_velocity_;
+    float dt_;
+    const std::vector<PolarPose>* detections_;
+    float inv_stdev_range_;
+    float inv_stdev_angle_;
+    const SensorFOV_t* sensor_fov_;
+
+    typedef void (CParticleFilter::*RangeFunction)(size_t begin, size_t end, size_t chunk);
+    void runParallel(RangeFunction f, size_t n);
+    void predictRange(size_t begin, size_t end, size_t chunk);
+    void likelihoodRange(size_t begin, size_t end, size_t chunk);
+
+    void spawnUniform(size_t n);
+    void spawn(size_t i, const Birth_t& birth, uint32_t& state);
+    void resize(size_t n);
+
+public:
+    CParticleFilter(const SensorFOV_t& fov,
+                    const CellProbability_t& cell_probability,
+                    size_t particles_per_person,
+                    size_t min_particles,
+                    size_t max_particles,
+                    float detection_probability,
+                    float false_positive_probability,
+                    float birth_ratio = 0.1,
+                    float speed_noise = 1.5,
+                    float max_speed = 1.5,
+                    int threads = 1);
+
+    size_t size() const {return x_.size();}
+
+    // people walk, the robot moves
+    void predict(const Velocity_t& robot_velocity, float dt);
+
+    // stdev.angle in degrees, as CGrid::stdev
+    void update(const std::vector<PolarPose>& detections, const PolarPose& stdev,
+                const SensorFOV_t& sensor_fov);
+
+    void resample();
+
+    // particle mass per cell of map, scaled so that the fullest cell is 1
+    void rasterise(const MapMetaData_t& map, std::vector<float>& grid) const;
+    void project(int angle_step, geometry_msgs::PoseArray& projection) const;
+};
+
+#endif // PARTICLEFILTER_H
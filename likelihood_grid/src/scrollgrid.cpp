@@ -0,0 +1,159 @@
+#include "scrollgrid.h"
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+CScrollingGrid::CScrollingGrid(uint32_t size, float resolution, float fill):
+    size_(size),
+    resolution_(resolution),
+    fill_(fill)
+{
+    ROS_ASSERT(size_ > 0 && resolution_ > 0.0);
+    data_.resize(size_ * size_, fill_);
+    reset();
+}
+
+void CScrollingGrid::reset()
+{
+    data_.assign(size_ * size_, fill_);
+    origin_x_ = origin_y_ = 0;
+    offset_x_ = offset_y_ = 0;
+    initialized_ = false;
+}
+
+uint32_t CScrollingGrid::wrap(int v) const
+{
+    int m = v % (int) size_;
+    return (uint32_t) ((m < 0) ? m + (int) size_ : m);
+}
+
+void CScrollingGrid::clearColumn(uint32_t rx)
+{
+    for(uint32_t ry = 0; ry < size_; ry++) data_[rx + ry * size_] = fill_;
+}
+
+void CScrollingGrid::clearRow(uint32_t ry)
+{
+    std::fill(data_.begin() + ry * size_, data_.begin() + (ry + 1) * size_, fill_);
+}
+
+void CScrollingGrid::scrollTo(float x, float y)
+{
+    int robot_x = (int) floor(x / resolution_);
+    int robot_y = (int) floor(y / resolution_);
+
+    int new_origin_x = robot_x - (int) size_ / 2;
+    int new_origin_y = robot_y - (int) size_ / 2;
+
+    if(!initialized_)
+    {
+        origin_x_ = new_origin_x;
+        origin_y_ = new_origin_y;
+        initialized_ = true;
+        return;
+    }
+
+    int dx = new_origin_x - origin_x_;
+    int dy = new_origin_y - origin_y_;
+
+    if(dx == 0 && dy == 0) return;
+
+    if(abs(dx) >= (int) size_ || abs(dy) >= (int) size_)
+    {
+        /* Jumped further than the window, nothing can be kept */
+        data_.assign(size_ * size_, fill_);
+        origin_x_ = new_origin_x;
+        origin_y_ = new_origin_y;
+        offset_x_ = offset_y_ = 0;
+        return;
+    }
+
+    /*
+     * The columns (rows) leaving the window are reused for the ones coming in.
+     * Moving forward, they are the first |d| ring positions of the old window;
+     * moving backward, the first |d| ring positions of the new one.
+     */
+    uint32_t new_offset_x = wrap((int) offset_x_ + dx);
+    uint32_t first_x = (dx > 0) ? offset_x_ : new_offset_x;
+    for(int k = 0; k < abs(dx); k++) clearColumn(wrap((int) first_x + k));
+
+    uint32_t new_offset_y = wrap((int) offset_y_ + dy);
+    uint32_t first_y = (dy > 0) ? offset_y_ : new_offset_y;
+    for(int k = 0; k < abs(dy); k++) clearRow(wrap((int) first_y + k));
+
+    offset_x_ = new_offset_x;
+    offset_y_ = new_offset_y;
+    origin_x_ = new_origin_x;
+    origin_y_ = new_origin_y;
+}
+
+bool CScrollingGrid::inside(int wx, int wy) const
+{
+    return (wx >= origin_x_ && wx < origin_x_ + (int) size_ &&
+            wy >= origin_y_ && wy < origin_y_ + (int) size_);
+}
+
+bool CScrollingGrid::worldToCell(float x, float y, int& wx, int& wy) const
+{
+    wx = (int) floor(x / resolution_);
+    wy = (int) floor(y / resolution_);
+    return inside(wx, wy);
+}
+
+void CScrollingGrid::sampleRobotView(const Pose2D_t& robot, const MapMetaData_t& map,
+                                     std::vector<float>& robot_view) const
+{
+    ROS_ASSERT(robot_view.size() == map.cell.size());
+
+    float c = cos(robot.yaw);
+    float s = sin(robot.yaw);
+    int wx, wy;
+
+    for(size_t i = 0; i < map.cell.size(); i++)
+    {
+        float x = map.cell[i].cartesian.x;
+        float y = map.cell[i].cartesian.y;
+
+        bool in = worldToCell(robot.x + c * x - s * y, robot.y + s * x + c * y, wx, wy);
+        robot_view[i] = (in) ? data_[ringIndex(wx, wy)] : fill_;
+    }
+}
+
+void CScrollingGrid::storeRobotView(const Pose2D_t& robot, const MapMetaData_t& map,
+                                    const std::vector<float>& robot_view)
+{
+    ROS_ASSERT(robot_view.size() == map.width * map.height);
+
+    /*
+     * Go through the world cells and look each one up in the robot-centric
+     * grid, so that rotated views leave no holes in the world grid.
+     * Cells the robot-centric grid does not cover keep their old value.
+     */
+
+    float c = cos(robot.yaw);
+    float s = sin(robot.yaw);
+    float x_min = map.origin.position.x;
+    float y_min = map.origin.position.y;
+
+    for(uint32_t j = 0; j < size_; j++)
+    {
+        int wy = origin_y_ + j;
+        float dy = (wy + 0.5) * resolution_ - robot.y;
+
+        for(uint32_t i = 0; i < size_; i++)
+        {
+            int wx = origin_x_ + i;
+            float dx = (wx + 0.5) * resolution_ - robot.x;
+
+            float x = c * dx + s * dy;
+            float y = -s * dx + c * dy;
+
+            int r = (int) floor((x - x_min) / map.resolution);
+            int col = (int) floor((y - y_min) / map.resolution);
+
+            if(r < 0 || col < 0 || r >= (int) map.height || col >= (int) map.width) continue;
+
+            data_[ringIndex(wx, wy)] = robot_view[r + col * map.height];
+        }
+    }
+}
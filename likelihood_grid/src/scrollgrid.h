@@ -0,0 +1,60 @@
+#ifndef SCROLLGRID_H
+#define SCROLLGRID_H
+
+#include <vector>
+#include "grid.h"
+
+/*
+ * World-fixed (odom frame) square window of cells kept in a circular 2-D
+ * buffer. The window follows the robot by whole cells: moving by k cells
+ * only clears the k rows/columns that scroll in, everything else keeps its
+ * value and its place in memory. The robot view is sampled at the exact
+ * robot pose, so the motion left inside a cell is not lost.
+ *
+ * World cell (wx, wy) covers [wx * resolution, (wx + 1) * resolution).
+ */
+
+class CScrollingGrid
+{
+private:
+    std::vector<float> data_;   // ring buffer, x is the fast index
+    uint32_t size_;             // cells per side
+    float resolution_;          // [m/cell]
+    float fill_;                // value of cells that scroll in
+
+    int origin_x_;              // world cell of the window's lower left corner
+    int origin_y_;
+    uint32_t offset_x_;         // ring position of the window's lower left corner
+    uint32_t offset_y_;
+    bool initialized_;
+
+    inline size_t ringIndex(int wx, int wy) const
+    {
+        uint32_t rx = (offset_x_ + (wx - origin_x_)) % size_;
+        uint32_t ry = (offset_y_ + (wy - origin_y_)) % size_;
+        return rx + ry * size_;
+    }
+
+    void clearColumn(uint32_t rx);
+    void clearRow(uint32_t ry);
+    uint32_t wrap(int v) const;
+
+public:
+    CScrollingGrid(uint32_t size, float resolution, float fill);
+
+    void reset();
+    void scrollTo(float x, float y);
+
+    bool inside(int wx, int wy) const;
+    bool worldToCell(float x, float y, int& wx, int& wy) const;
+
+    void sampleRobotView(const Pose2D_t& robot, const MapMetaData_t& map,
+                         std::vector<float>& robot_view) const;
+    void storeRobotView(const Pose2D_t& robot, const MapMetaData_t& map,
+                        const std::vector<float>& robot_view);
+
+    uint32_t size() const {return size_;}
+    float resolution() const {return resolution_;}
+};
+
+#endif // SCROLLGRID_H
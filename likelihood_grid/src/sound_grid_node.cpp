@@ -36,6 +36,10 @@ int main(int argc, char** argv)
                                       &sound_grid, _1, _2));
 
 
+    // Callbacks run on their own thread and only hand the messages over to spin()
+    ros::AsyncSpinner spinner(1);
+    spinner.start();
+
     while (ros::ok())
     {
         sound_grid.spin();
@@ -44,8 +48,6 @@ int main(int argc, char** argv)
             ROS_ERROR("Sound Grid: It is taking too long! %f", looprate.cycleTime().toSec());
         if(!looprate.sleep())
             ROS_ERROR("Not enough time left");
-
-        ros::spinOnce();
     }
 
     return 0;
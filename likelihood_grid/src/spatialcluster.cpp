@@ -0,0 +1,102 @@
+#include "spatialcluster.h"
+#include <ros/ros.h>
+#include <cmath>
+
+CSpatialCluster::CSpatialCluster(float radius):
+    radius_(radius),
+    mask_(0)
+{
+}
+
+size_t CSpatialCluster::findBucket(uint64_t key) const
+{
+    /* Linear probing, stops at the key or at a free bucket */
+    size_t h = (size_t) (key * 0x9E3779B97F4A7C15ULL >> 32) & mask_;
+    while(table_[h].head >= 0 && table_[h].key != key)
+        h = (h + 1) & mask_;
+    return h;
+}
+
+int CSpatialCluster::findRoot(int i)
+{
+    while(parent_[i] != i)
+    {
+        parent_[i] = parent_[parent_[i]];
+        i = parent_[i];
+    }
+    return i;
+}
+
+void CSpatialCluster::unite(int a, int b)
+{
+    a = findRoot(a);
+    b = findRoot(b);
+    if(a == b) return;
+
+    /* The lower index becomes the root, keeps the result deterministic */
+    if(a < b) parent_[b] = a;
+    else parent_[a] = b;
+}
+
+size_t CSpatialCluster::cluster(const std::vector<float>& x, const std::vector<float>& y,
+                                std::vector<size_t>& label)
+{
+    ROS_ASSERT(x.size() == y.size());
+    ROS_ASSERT(radius_ > 0.0);
+
+    const int n = (int) x.size();
+    label.resize(n);
+    if(n == 0) return 0;
+
+    /* At most half full */
+    size_t buckets = 16;
+    while(buckets < 2 * (size_t) n) buckets <<= 1;
+    Bucket_t free_bucket = {0, -1};
+    table_.assign(buckets, free_bucket);
+    mask_ = buckets - 1;
+
+    next_.assign(n, -1);
+    parent_.resize(n);
+    for(int i = 0; i < n; i++) parent_[i] = i;
+
+    const float inv_radius = 1.0 / radius_;
+    const float radius2 = radius_ * radius_;
+
+    for(int i = 0; i < n; i++)
+    {
+        int64_t cx = (int64_t) floorf(x[i] * inv_radius);
+        int64_t cy = (int64_t) floorf(y[i] * inv_radius);
+
+        /* Neighbours can only be in the 3x3 cells around */
+        for(int64_t dx = -1; dx <= 1; dx++)
+        {
+            for(int64_t dy = -1; dy <= 1; dy++)
+            {
+                size_t b = findBucket(cellKey(cx + dx, cy + dy));
+                for(int j = table_[b].head; j >= 0; j = next_[j])
+                {
+                    float ex = x[i] - x[j];
+                    float ey = y[i] - y[j];
+                    if(ex * ex + ey * ey < radius2) unite(i, j);
+                }
+            }
+        }
+
+        size_t b = findBucket(cellKey(cx, cy));
+        table_[b].key = cellKey(cx, cy);
+        next_[i] = table_[b].head;
+        table_[b].head = i;
+    }
+
+    /* Number the clusters in order of appearance */
+    root_label_.assign(n, -1);
+    size_t clusters = 0;
+    for(int i = 0; i < n; i++)
+    {
+        int r = findRoot(i);
+        if(root_label_[r] < 0) root_label_[r] = (int) clusters++;
+        label[i] = root_label_[r];
+    }
+
+    return clusters;
+}
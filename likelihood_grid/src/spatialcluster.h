@@ -0,0 +1,51 @@
+#ifndef SPATIALCLUSTER_H
+#define SPATIALCLUSTER_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+/*
+ * Groups 2D points into clusters: two points closer than the radius end up
+ * in the same cluster, transitively (single linkage). The points are binned
+ * into a uniform hash grid with cells of one radius, so each point is only
+ * compared with the points in its 3x3 neighbourhood, and connected pairs are
+ * merged with union-find. Expected O(n) for bounded density.
+ *
+ * Labels are numbered in the order of the first point of each cluster, so the
+ * result does not depend on anything but the input order.
+ */
+
+class CSpatialCluster
+{
+private:
+    float radius_;
+
+    struct Bucket_t{
+        uint64_t key;
+        int head;           // first point in the cell, -1 if the bucket is free
+    };
+
+    std::vector<Bucket_t> table_;
+    std::vector<int> next_;         // next point in the same cell
+    std::vector<int> parent_;
+    std::vector<int> root_label_;
+    size_t mask_;
+
+    static uint64_t cellKey(int64_t cx, int64_t cy) {return ((uint64_t) cx << 32) ^ (uint32_t) cy;}
+    size_t findBucket(uint64_t key) const;
+    int findRoot(int i);
+    void unite(int a, int b);
+
+public:
+    CSpatialCluster(float radius = 1.0);
+
+    void setRadius(float radius) {radius_ = radius;}
+    float radius() const {return radius_;}
+
+    // returns the number of clusters, label[i] in [0, clusters)
+    size_t cluster(const std::vector<float>& x, const std::vector<float>& y,
+                   std::vector<size_t>& label);
+};
+
+#endif // SPATIALCLUSTER_H
@@ -0,0 +1,64 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <atomic>
+#include <stdint.h>
+
+/*
+ * Lock-free handoff of the latest value from one writer thread (a ROS
+ * callback) to one reader thread (the spin loop). The writer fills its own
+ * buffer and publishes it by swapping it with the middle one; the reader
+ * swaps its buffer with the middle one only when that holds something new.
+ * Neither side ever waits and a value is never read while it is written;
+ * values the reader did not pick up in time are overwritten.
+ */
+
+template <typename T>
+class CTripleBuffer
+{
+private:
+    static const uint8_t INDEX = 0x03;
+    static const uint8_t FRESH = 0x04;
+
+    T buffers_[3];
+    std::atomic<uint8_t> middle_;   // index of the middle buffer | FRESH
+    uint8_t write_;                 // owned by the writer
+    uint8_t read_;                  // owned by the reader
+
+    CTripleBuffer(const CTripleBuffer&);
+    CTripleBuffer& operator=(const CTripleBuffer&);
+
+public:
+    CTripleBuffer():
+        middle_(1),
+        write_(0),
+        read_(2)
+    {
+    }
+
+    // writer side
+    T& writeBuffer() {return buffers_[write_];}
+
+    void publish()
+    {
+        write_ = middle_.exchange(write_ | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    void write(const T& value)
+    {
+        buffers_[write_] = value;
+        publish();
+    }
+
+    // reader side: true when readBuffer() changed
+    bool update()
+    {
+        if(!(middle_.load(std::memory_order_acquire) & FRESH)) return false;
+        read_ = middle_.exchange(read_, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    const T& readBuffer() const {return buffers_[read_];}
+};
+
+#endif // TRIPLEBUFFER_H
@@ -35,6 +35,10 @@ int main(int argc, char** argv)
                                       &vision_grid, _1, _2));
 
 
+    // Callbacks run on their own thread and only hand the messages over to spin()
+    ros::AsyncSpinner spinner(1);
+    spinner.start();
+
     while (ros::ok())
     {
         vision_grid.spin();
@@ -43,8 +47,6 @@ int main(int argc, char** argv)
             ROS_ERROR("Sound Grid: It is taking too long! %f", looprate.cycleTime().toSec());
         if(!looprate.sleep())
             ROS_ERROR("Not enough time left");
-
-        ros::spinOnce();
     }
 
     return 0;
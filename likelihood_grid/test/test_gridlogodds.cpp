@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+#include <vector>
+#include <cstdlib>
+#include "grid.h"
+#include "gridlogodds.h"
+
+/*
+ * The compact storage mode of CGrid (int16_t log-odds, SSE2 kernel) against
+ * the float filter on the same detections.
+ *
+ * Each update rounds the log-likelihood ratio to 1/LOG_ODDS_SCALE, which is
+ * at most 0.5/256 in log-odds or 0.5/1024 in probability (dp/dl <= 1/4), plus
+ * the same again when a cell above human is scaled back. The free and human
+ * bounds stop the error from growing, but even summed over every update of
+ * CYCLES cycles it stays below TOLERANCE.
+ */
+
+const int CYCLES = 20;
+const float TOLERANCE = 0.02;
+
+/* The scalar reference of logOddsUpdateKernel */
+int16_t referenceUpdate(std::vector<int16_t>& state, const std::vector<int16_t>& update,
+                        const std::vector<int16_t>& lower)
+{
+    int16_t max_state = -32768;
+    for(size_t i = 0; i < state.size(); i++){
+        int32_t s = (int32_t) state[i] + update[i];
+        s = std::min(std::max(s, (int32_t) -32768), (int32_t) 32767);
+        state[i] = (int16_t) std::max(s, (int32_t) lower[i]);
+        max_state = std::max(max_state, state[i]);
+    }
+    return max_state;
+}
+
+void checkKernel(size_t n, unsigned int seed)
+{
+    srand(seed);
+    std::vector<int16_t> state(n), update(n), lower(n);
+    for(size_t i = 0; i < n; i++){
+        state[i] = (int16_t) (rand() % 65536 - 32768);
+        update[i] = (int16_t) (rand() % 65536 - 32768);
+        lower[i] = (rand() % 4) ? -32768 : (int16_t) (rand() % 2048 - 1024);
+    }
+
+    // Both saturation bounds, in the SIMD lanes and in the tail
+    for(size_t i = 0; i < n; i += 3){
+        state[i] = (i % 2) ? 32760 : -32760;
+        update[i] = (i % 2) ? 100 : -100;
+        lower[i] = -32768;
+    }
+
+    std::vector<int16_t> expected = state;
+    int16_t expected_max = referenceUpdate(expected, update, lower);
+    int16_t max_state = logOddsUpdateKernel(n, &state[0], &update[0], &lower[0]);
+
+    EXPECT_EQ(expected_max, max_state);
+    for(size_t i = 0; i < n; i++) EXPECT_EQ(expected[i], state[i]) << "cell " << i << " of " << n;
+}
+
+TEST(LogOddsKernel, matchesScalarReference)
+{
+    checkKernel(8 * 16, 1);
+}
+
+TEST(LogOddsKernel, scalarTail)
+{
+    // Cells past the last full eight lanes, and a grid with no full lane
+    checkKernel(8 * 16 + 5, 2);
+    checkKernel(7, 3);
+    checkKernel(1, 4);
+}
+
+TEST(LogOddsKernel, saturates)
+{
+    int16_t state[9]  = {32767, 32000, -32768, -32000,     0, 32767, -32768, 100, 32767};
+    int16_t update[9] = {    1,  1000,     -1,  -1000, 32767, 32767, -32768, 100, -32768};
+    int16_t lower[9]  = {-32768, -32768, -32768, -100, -32768, 0, -32768, 500, -32768};
+    int16_t expected[9] = {32767, 32767, -32768, -100, 32767, 32767, -32768, 500, -1};
+
+    EXPECT_EQ(32767, logOddsUpdateKernel(9, state, update, lower));
+    for(size_t i = 0; i < 9; i++) EXPECT_EQ(expected[i], state[i]) << "cell " << i;
+}
+
+CGrid* makeGrid()
+{
+    CellProbability_t cp;
+    cp.free = 0.1;
+    cp.human = 0.9;
+    cp.unknown = 0.5;
+
+    SensorFOV_t sfov;
+    sfov.range.max = 10;
+    sfov.range.min = 0.5;
+    sfov.angle.max = angles::from_degrees(135.0);
+    sfov.angle.min = angles::from_degrees(-135.0);
+
+    // 10 x 10 cells: twelve full SIMD lanes and a tail of four
+    CGrid* grid = new CGrid(10, sfov, 0.5, cp, 0.9, 0.1, 5);
+    grid->stdev.range = 0.2;
+    grid->stdev.angle = 2.0;
+    return grid;
+}
+
+TEST(LogOddsGrid, matchesFloatFilter)
+{
+    CGrid* float_grid = makeGrid();
+    CGrid* log_odds_grid = makeGrid();
+    log_odds_grid->setLogOddsStorage(true);
+    ASSERT_EQ(100u, log_odds_grid->grid_size);
+
+    float max_error = 0.0;
+    for(int k = 0; k < CYCLES; k++){
+        // A person standing still long enough to reach human, then gone to let the cells fall to free
+        std::vector<PolarPose> detections;
+        if(k < CYCLES / 2){
+            detections.push_back(PolarPose(1.5, angles::from_degrees(30.0)));
+            if(k % 3 == 0) detections.push_back(PolarPose(2.0, angles::from_degrees(-45.0)));
+        }
+
+        CGrid* grids[2] = {float_grid, log_odds_grid};
+        for(int g = 0; g < 2; g++){
+            grids[g]->polar_array.predicted = grids[g]->polar_array.past;
+            grids[g]->polar_array.current = detections;
+            grids[g]->bayesOccupancyFilter();
+        }
+
+        for(size_t i = 0; i < float_grid->grid_size; i++){
+            float error = fabs(float_grid->posterior[i] - log_odds_grid->posterior[i]);
+            max_error = std::max(max_error, error);
+            ASSERT_LE(error, TOLERANCE) << "cell " << i << " in cycle " << k;
+        }
+    }
+
+    RecordProperty("max_error_x1e6", (int) (max_error * 1e6));
+    delete float_grid;
+    delete log_odds_grid;
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    ros::Time::init();
+    return RUN_ALL_TESTS();
+}